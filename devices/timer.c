@@ -3,10 +3,12 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -17,57 +19,87 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input frequency, and the counter value that divides it
+   down to TIMER_FREQ, rounded to nearest. */
+#define PIT_HZ 1193180
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* -nohz: Stop the periodic tick while the CPU is idle? */
+bool timer_nohz;
+
+/* While the idle thread sleeps in -nohz mode, the PIT runs in
+   one-shot mode for ONESHOT_COUNT input cycles, which cover
+   ONESHOT_TICKS tick boundaries.  The first boundary comes after
+   ONESHOT_FIRST cycles and the others every PIT_TICK_COUNT. */
+static bool oneshot_armed;
+static unsigned oneshot_count;
+static unsigned oneshot_first;
+static int64_t oneshot_ticks;
+
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* Number of timer ticks over which timer_calibrate() counts TSC
+   cycles. */
+#define CALIBRATE_TICKS 5
+
+/* TSC frequency in cycles per second, or 0 until
+   timer_calibrate() has measured it, and the TSC and the
+   nanosecond clock at the tick boundary where it started. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static int64_t ns_base;
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
-static void real_time_sleep (int64_t num, int32_t denom);
+static uint64_t ns_to_cycles (int64_t ns);
+static void real_time_sleep (int64_t ns);
+static void pit_periodic (void);
+static void pit_oneshot (unsigned first, int64_t tick_cnt);
+static unsigned pit_read (void);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
-
+	pit_periodic ();
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Measures the TSC frequency against the timer, which
+   timer_ns() and the sub-tick sleeps are based on.  The TSC is
+   assumed to run at a constant rate, as it does on any CPU with
+   an invariant TSC and under QEMU. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	enum intr_level old_level;
+	uint64_t start_tsc, end_tsc;
+	int64_t start;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+	/* Count the cycles between two tick boundaries. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
+	start = ticks;
+	start_tsc = rdtsc ();
+	while (ticks - start < CALIBRATE_TICKS)
+		barrier ();
+	end_tsc = rdtsc ();
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	/* The scheduler trace reads the clock with interrupts off. */
+	old_level = intr_disable ();
+	tsc_base = start_tsc;
+	ns_base = start * NS_PER_TICK;
+	tsc_hz = (end_tsc - start_tsc) * TIMER_FREQ / CALIBRATE_TICKS;
+	intr_set_level (old_level);
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	printf ("%'"PRIu64" cycles/s.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -87,6 +119,38 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the time-stamp counter, for measuring short intervals
+   in CPU cycles.  timer_cycles_to_ns() converts a difference of
+   two readings to nanoseconds. */
+uint64_t
+timer_cycles (void) {
+	return rdtsc ();
+}
+
+/* Converts CYCLES TSC cycles to nanoseconds.  Before
+   timer_calibrate() has run, returns 0. */
+int64_t
+timer_cycles_to_ns (uint64_t cycles) {
+	if (tsc_hz == 0)
+		return 0;
+
+	/* Split off whole seconds so that the product cannot
+	   overflow. */
+	return (cycles / tsc_hz) * 1000000000
+		+ (cycles % tsc_hz) * 1000000000 / tsc_hz;
+}
+
+/* Returns the number of nanoseconds since the OS booted.  The
+   clock is monotonic and, once timer_calibrate() has run,
+   advances with the TSC between ticks.  Safe to call with
+   interrupts off or from an interrupt handler. */
+int64_t
+timer_ns (void) {
+	if (tsc_hz == 0)
+		return timer_ticks () * NS_PER_TICK;
+	return ns_base + timer_cycles_to_ns (rdtsc () - tsc_base);
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {		// sleep until 까지 더 자야하는 시간 = ticks
@@ -108,19 +172,19 @@ timer_sleep (int64_t ticks) {		// sleep until 까지 더 자야하는 시간 = t
 /* Suspends execution for approximately MS milliseconds. */
 void
 timer_msleep (int64_t ms) {
-	real_time_sleep (ms, 1000);
+	real_time_sleep (ms * 1000 * 1000);
 }
 
 /* Suspends execution for approximately US microseconds. */
 void
 timer_usleep (int64_t us) {
-	real_time_sleep (us, 1000 * 1000);
+	real_time_sleep (us * 1000);
 }
 
 /* Suspends execution for approximately NS nanoseconds. */
 void
 timer_nsleep (int64_t ns) {
-	real_time_sleep (ns, 1000 * 1000 * 1000);
+	real_time_sleep (ns);
 }
 
 /* Prints timer statistics. */
@@ -129,70 +193,183 @@ timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
-/* Timer interrupt handler. */
+/* Called by the idle thread, with interrupts off and no thread
+   ready to run, just before it halts.  In -nohz mode, replaces
+   the periodic tick with a single interrupt at the earliest
+   sleeper's deadline or delayed work, or as far out as the
+   16-bit PIT counter allows. */
+void
+timer_nohz_enter (void) {
+	int64_t delta;
+	unsigned first;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_nohz || oneshot_armed)
+		return;
+
+	/* Don't bother unless at least one tick can be skipped. */
+	delta = get_next_tick_to_awake ();
+	if (workqueue_next_due () < delta)
+		delta = workqueue_next_due ();
+	delta -= ticks;
+	if (delta <= 1)
+		return;
+
+	/* A tick that came due since interrupts went off is still
+	   latched in the PIC.  Let it be delivered first: once the
+	   one-shot is armed, timer_interrupt() would count it as the
+	   whole one-shot period. */
+	if (intr_ext_pending (0x20))
+		return;
+
+	/* Start the one-shot where the current period would have
+	   ended, so that ticks stay in phase. */
+	first = pit_read ();
+	if (first == 0 || first > PIT_TICK_COUNT)
+		return;
+	if (delta - 1 > (0xffff - first) / PIT_TICK_COUNT)
+		delta = (0xffff - first) / PIT_TICK_COUNT + 1;
+	pit_oneshot (first, delta);
+
+	/* The period may also have ended between reading the counter
+	   and reprogramming it.  The one-shot cannot have expired yet,
+	   since it covers at least two tick boundaries, so a pending
+	   interrupt is that ordinary tick: go back to periodic mode. */
+	if (intr_ext_pending (0x20)) {
+		oneshot_armed = false;
+		pit_periodic ();
+	}
+}
+
+/* Called on any external interrupt other than the timer's.  If
+   the interrupt woke the idle thread out of a one-shot sleep,
+   accounts for the ticks that have passed so far and arranges
+   for the periodic tick to resume at the next tick boundary. */
+void
+timer_nohz_exit (void) {
+	unsigned remaining, elapsed, next;
+	int64_t passed;
+
+	ASSERT (intr_context ());
+
+	if (!oneshot_armed)
+		return;
+
+	/* If the counter already expired, the timer interrupt is
+	   pending and will do the accounting itself. */
+	remaining = pit_read ();
+	if (remaining == 0 || remaining > oneshot_count)
+		return;
+
+	elapsed = oneshot_count - remaining;
+	passed = elapsed < oneshot_first ? 0
+		: (elapsed - oneshot_first) / PIT_TICK_COUNT + 1;
+	if (passed >= oneshot_ticks)
+		return;
+
+	next = oneshot_first + passed * PIT_TICK_COUNT - elapsed;
+	pit_oneshot (next, 1);
+	while (passed-- > 0) {
+		ticks++;
+		thread_tick ();
+	}
+	if (ticks >= get_next_tick_to_awake ())
+		thread_awake (ticks);
+	workqueue_tick (ticks);
+}
+
+/* Timer interrupt handler.  After a one-shot sleep, replays the
+   ticks that were skipped so that the statistics and the MLFQS
+   see every one of them. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
-	thread_tick ();
-	
-	// next_tick = get_next_tick_to_awake();
-	thread_awake(ticks);
-	
+	int64_t elapsed = 1;
+
+	if (oneshot_armed) {
+		elapsed = oneshot_ticks;
+		oneshot_armed = false;
+		pit_periodic ();
+	}
+
+	while (elapsed-- > 0) {
+		ticks++;
+		thread_tick ();
+	}
+
+	/* Nothing to do unless the earliest sleeper or delayed work
+	   is due. */
+	if (ticks >= get_next_tick_to_awake ())
+		thread_awake (ticks);
+	workqueue_tick (ticks);
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+/* Programs PIT counter 0 to interrupt TIMER_FREQ times per
+   second. */
+static void
+pit_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, PIT_TICK_COUNT & 0xff);
+	outb (0x40, PIT_TICK_COUNT >> 8);
+}
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+/* Programs PIT counter 0 to interrupt once, TICK_CNT tick
+   boundaries from now, the first of which is FIRST input cycles
+   away. */
+static void
+pit_oneshot (unsigned first, int64_t tick_cnt) {
+	unsigned count = first + (tick_cnt - 1) * PIT_TICK_COUNT;
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+	ASSERT (tick_cnt >= 1);
+	ASSERT (count > 0 && count <= 0xffff);
+
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+
+	oneshot_armed = true;
+	oneshot_count = count;
+	oneshot_first = first;
+	oneshot_ticks = tick_cnt;
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Returns the current value of PIT counter 0. */
+static unsigned
+pit_read (void) {
+	unsigned lo, hi;
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+	outb (0x43, 0x00);    /* CW: counter 0, latch. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return (hi << 8) | lo;
 }
 
-/* Sleep for approximately NUM/DENOM seconds. */
-static void
-real_time_sleep (int64_t num, int32_t denom) {
-	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
+/* Converts NS nanoseconds to TSC cycles. */
+static uint64_t
+ns_to_cycles (int64_t ns) {
+	return (ns / 1000000000) * tsc_hz
+		+ (ns % 1000000000) * tsc_hz / 1000000000;
+}
 
-	   (NUM / DENOM) s
-	   ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
-	   1 s / TIMER_FREQ ticks
-	   */
-	int64_t ticks = num * TIMER_FREQ / denom;
+/* Sleeps for approximately NS nanoseconds. */
+static void
+real_time_sleep (int64_t ns) {
+	uint64_t deadline;
+	int64_t ticks;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
-		/* We're waiting for at least one full timer tick.  Use
-		   timer_sleep() because it will yield the CPU to other
-		   processes. */
+	ASSERT (tsc_hz != 0);
+	if (ns <= 0)
+		return;
+
+	/* Whole ticks are spent in timer_sleep(), which yields the
+	   CPU to other threads.  Since that may wake up early by
+	   part of a tick, spin for whatever is left of the TSC
+	   deadline. */
+	deadline = rdtsc () + ns_to_cycles (ns);
+	ticks = ns / NS_PER_TICK;
+	if (ticks > 0)
 		timer_sleep (ticks);
-	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
-	}
+	while (rdtsc () < deadline)
+		asm volatile ("pause");
 }
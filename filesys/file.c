@@ -1,29 +1,49 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
-/* An open file. */
+/* An open file.
+
+   Reads may run concurrently, holding the file system lock only
+   shared, and the threads of a process share its open files, so
+   POS_LOCK keeps two reads of one file from racing on POS.  Calls
+   that change POS otherwise hold the file system lock
+   exclusive. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	struct lock pos_lock;       /* Serializes file_read() calls. */
 };
 
+/* Cache that open files are allocated from. */
+static struct kmem_cache *file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void) {
+	file_cache = kmem_cache_create ("file", sizeof (struct file), NULL);
+	if (file_cache == NULL)
+		PANIC ("cannot create file cache");
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) {
-	struct file *file = calloc (1, sizeof *file);
+	struct file *file = kmem_cache_alloc (file_cache);
 	if (inode != NULL && file != NULL) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		lock_init (&file->pos_lock);
 		return file;
 	} else {
 		inode_close (inode);
-		free (file);
+		kmem_cache_free (file_cache, file);
 		return NULL;
 	}
 }
@@ -54,7 +74,7 @@ file_close (struct file *file) {
 	if (file != NULL) {
 		file_allow_write (file);
 		inode_close (file->inode);
-		free (file);
+		kmem_cache_free (file_cache, file);
 	}
 }
 
@@ -68,11 +88,16 @@ file_get_inode (struct file *file) {
  * starting at the file's current position.
  * Returns the number of bytes actually read,
  * which may be less than SIZE if end of file is reached.
- * Advances FILE's position by the number of bytes read. */
+ * Advances FILE's position by the number of bytes read.
+ * Safe to call on the same FILE from more than one thread. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
-	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	off_t bytes_read;
+
+	lock_acquire (&file->pos_lock);
+	bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_read;
+	lock_release (&file->pos_lock);
 	return bytes_read;
 }
 
@@ -2,17 +2,27 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* -nohz: Stop the periodic tick while the CPU is idle? */
+extern bool timer_nohz;
+
 void timer_init (void);
 void timer_calibrate (void);
+void timer_nohz_enter (void);
+void timer_nohz_exit (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+uint64_t timer_cycles (void);
+int64_t timer_cycles_to_ns (uint64_t cycles);
+int64_t timer_ns (void);
+
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
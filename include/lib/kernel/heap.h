@@ -0,0 +1,66 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+ *
+ * This is an intrusive pairing heap.  Like the list and hash
+ * table implementations, it does not use dynamic allocation:
+ * each structure that can potentially be in a heap must embed a
+ * struct heap_elem member, and heap_entry() converts a heap_elem
+ * back into the structure that contains it.
+ *
+ * The element that the LESS function orders first is at the
+ * top of the heap.  Pass a "greater than" function to get a
+ * max-heap.
+ *
+ * Costs: heap_top() is O(1), heap_push() is O(1), and heap_pop()
+ * and heap_remove() of an arbitrary element are O(log n)
+ * amortized.  After changing the key of an element that is in
+ * the heap, call heap_update() to restore the heap order. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* Leftmost child. */
+	struct heap_elem *next;     /* Right sibling. */
+	struct heap_elem *prev;     /* Left sibling, or parent if leftmost. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+ * the structure that HEAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A should be closer to the
+ * top of the heap than B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+		const struct heap_elem *b,
+		void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Top element, or null if empty. */
+	size_t elem_cnt;            /* Number of elements. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,16 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+/* CPU and scheduling statistics for one thread, as kept by the
+   kernel and returned by the getrusage() system call.  Times are
+   in timer ticks. */
+struct rusage {
+	long long user_ticks;       /* Ticks running in user mode. */
+	long long kernel_ticks;     /* Ticks running in kernel mode. */
+	long long ready_ticks;      /* Ticks runnable but not running. */
+	long long lock_wait_ticks;  /* Ticks blocked in lock_acquire(). */
+	long long vol_switches;     /* Switches away because it blocked. */
+	long long invol_switches;   /* Switches away while still runnable. */
+};
+
+#endif /* lib/rusage.h */
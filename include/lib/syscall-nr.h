@@ -36,6 +36,16 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_GETRUSAGE,              /* Get CPU and scheduling statistics. */
+	SYS_SET_TICKETS,            /* Set the stride scheduler share. */
+	SYS_FUTEX_WAIT,             /* Sleep if a user int holds a value. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a user int. */
+	SYS_THREAD_SPAWN,           /* Start a thread in this process. */
+	SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+	SYS_CLOCK_GETTIME,          /* Read a clock in nanoseconds. */
+	SYS_THREAD_QUIT,            /* Terminate this thread only. */
 };
 
 #endif /* lib/syscall-nr.h */
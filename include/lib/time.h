@@ -0,0 +1,15 @@
+#ifndef __LIB_TIME_H
+#define __LIB_TIME_H
+
+#include <stdint.h>
+
+/* Clocks for the clock_gettime() system call. */
+#define CLOCK_MONOTONIC 1       /* Time since boot.  Never goes back. */
+
+/* A point in time, as returned by clock_gettime(). */
+struct timespec {
+	int64_t tv_sec;             /* Seconds. */
+	long tv_nsec;               /* Nanoseconds, 0 to 999,999,999. */
+};
+
+#endif /* lib/time.h */
@@ -0,0 +1,41 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* User-level mutex and condition variable, built on the
+   futex_wait() and futex_wake() system calls.  Neither makes a
+   system call unless some thread actually has to wait. */
+
+/* Mutex.  STATE is 0 if unlocked, 1 if locked, and 2 if locked
+   and some thread may be sleeping in futex_wait() for it. */
+struct mutex {
+	int state;
+};
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable.  SEQ changes on every signal, which is
+   what waiters sleep on.  WAITERS counts the threads waiting,
+   so that a signal nobody is waiting for stays in user space;
+   it is only touched with the associated mutex held. */
+struct condvar {
+	int seq;
+	int waiters;
+};
+
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+bool condvar_timedwait (struct condvar *, struct mutex *, int64_t timeout);
+void condvar_signal (struct condvar *, struct mutex *);
+void condvar_broadcast (struct condvar *, struct mutex *);
+
+#endif /* lib/user/synch.h */
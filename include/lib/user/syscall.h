@@ -4,11 +4,18 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <rusage.h>
+#include <time.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
@@ -50,6 +57,16 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Extensions. */
+int getrusage (struct rusage *usage);
+int set_tickets (int tickets);
+int futex_wait (int *addr, int expected, int64_t timeout);
+int futex_wake (int *addr, int cnt);
+tid_t thread_spawn (int (*func) (void *), void *aux);
+int thread_join (tid_t);
+void thread_quit (int status) NO_RETURN;
+int clock_gettime (int clock_id, struct timespec *ts);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
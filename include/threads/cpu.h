@@ -0,0 +1,55 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <heap.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/spinlock.h"
+#include "threads/thread.h"
+
+/* Maximum number of CPUs. */
+#define CPU_MAX 16
+
+/* Per-CPU scheduler state.
+
+   Every CPU schedules from its own run queues, so picking the
+   next thread touches only local state.  The run queues are
+   protected by RQ_LOCK, which is taken with interrupts off.
+
+   Only the bootstrap processor is brought up for now.  Once
+   application processors are, a CPU whose queues are empty
+   should take a ready thread from the busiest other CPU, under
+   that CPU's RQ_LOCK, before it goes idle.
+
+   A thread's `cpu' member names the CPU whose run queue it is
+   on, or that it is running on, or that it last ran on.  The
+   running thread finds its CPU through that member; see
+   this_cpu(). */
+struct cpu {
+	int id;                             /* CPU number. */
+	struct thread *idle_thread;         /* This CPU's idle thread. */
+	unsigned thread_ticks;              /* # of timer ticks since last yield. */
+
+	struct spinlock rq_lock;            /* Protects the members below. */
+
+	/* Threads in THREAD_READY state.  There is one FIFO queue
+	   per priority level, and bit N of ready_mask is set iff
+	   ready_queues[N] is nonempty, so the highest ready priority
+	   is a single bit scan away. */
+	struct list ready_queues[PRI_MAX + 1];
+	uint64_t ready_mask;
+	int ready_cnt;                      /* # of threads on the run queue. */
+
+	/* Under the stride scheduler the ready threads are kept
+	   instead in a min-heap ordered by pass value.  global_pass is
+	   the pass of the thread most recently scheduled here. */
+	struct heap stride_heap;
+	int64_t global_pass;
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+struct cpu *this_cpu (void);
+
+#endif /* threads/cpu.h */
@@ -0,0 +1,49 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Lock contention statistics.
+
+   Every lock and reader-writer lock carries a struct lockstat.
+   While the kernel runs with -lockstat, acquiring and releasing
+   a lock updates it.  Locks given a name with lock_init_named()
+   or rwlock_init_named() are also registered, and
+   lockstat_print() shows them at shutdown, most contended
+   first.  Only locks that live as long as the kernel may be
+   named, since a registered lock is never unregistered. */
+
+/* Number of waiting threads remembered for each lock. */
+#define LOCKSTAT_TOP 3
+
+/* A thread that had to wait for a lock. */
+struct lockstat_waiter {
+	int tid;                    /* Thread identifier, or 0 if unused. */
+	char name[16];              /* Name of the thread. */
+	long long waits;            /* Number of times it waited. */
+	long long wait_ns;          /* Nanoseconds spent waiting. */
+};
+
+/* Statistics for one lock. */
+struct lockstat {
+	char name[16];              /* Name, or empty if unnamed. */
+	struct lockstat *next;      /* Next named lock. */
+	long long acquired;         /* Number of acquisitions. */
+	long long contended;        /* Acquisitions that had to wait. */
+	long long wait_ns;          /* Nanoseconds spent waiting. */
+	long long max_wait_ns;      /* Longest single wait. */
+	long long hold_ns;          /* Nanoseconds it was held. */
+	int64_t held_since;         /* timer_ns() when it was last taken. */
+	struct lockstat_waiter top[LOCKSTAT_TOP]; /* Longest waiters. */
+};
+
+extern bool lockstat_enabled;
+
+void lockstat_init (struct lockstat *, const char *name);
+void lockstat_acquired (struct lockstat *, int64_t waited);
+void lockstat_hold (struct lockstat *);
+void lockstat_unhold (struct lockstat *);
+void lockstat_print (void);
+
+#endif /* threads/lockstat.h */
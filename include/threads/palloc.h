@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -19,5 +20,12 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_set_owner (void *page, void *owner);
+void *palloc_get_owner (const void *);
+void palloc_zero_init (void);
+bool palloc_zero_page (void);
+void palloc_print_stats (void);
+void palloc_zero_stats (enum palloc_flags, long long *hits,
+		long long *misses);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,31 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out objects of one fixed size, carved out of
+   single pages called "slabs", so that a structure that is
+   allocated and freed over and over does not pay for malloc()'s
+   rounding up to a power of two or share a lock with every other
+   structure of similar size.  Each cache has a lock of its own.
+
+   If a cache has a constructor, it is run on each object once,
+   when the slab holding it is created, not on every allocation.
+   Objects must be in their constructed state again when they are
+   freed, so that state that is expensive to set up can be kept
+   from one use to the next. */
+
+/* Constructor, given a fresh object. */
+typedef void kmem_ctor (void *obj);
+
+void kmem_init (void);
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		kmem_ctor *);
+void kmem_cache_destroy (struct kmem_cache *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
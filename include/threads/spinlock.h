@@ -0,0 +1,33 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* Spin lock.
+
+   Protects data that may be touched by more than one CPU, for
+   short stretches of code that never sleep.  A spin lock may
+   only be held with interrupts off: otherwise an interrupt
+   handler on the same CPU could spin forever on a lock that its
+   own CPU holds.  spin_lock_irqsave() turns interrupts off and
+   takes the lock in one step.
+
+   The sleeping primitives in synch.h are built on top of spin
+   locks: the spin lock guards the semaphore's value and waiter
+   list, and a thread that has to wait drops it before it
+   blocks. */
+struct spinlock {
+	volatile int locked;        /* 1 if held, 0 if free. */
+};
+
+void spin_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+bool spin_trylock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+bool spin_is_locked (const struct spinlock *);
+
+enum intr_level spin_lock_irqsave (struct spinlock *);
+void spin_unlock_irqrestore (struct spinlock *, enum intr_level);
+
+#endif /* threads/spinlock.h */
@@ -0,0 +1,21 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Saves the callee-saved registers of the running thread on its
+ * stack, stores its stack pointer in *SAVE_RSP, and resumes the
+ * next thread.  The next thread continues from NEXT_RSP if that
+ * is nonzero, or else from the full frame NEXT_TF.  Interrupts
+ * must be off.  See switch.S for details. */
+void context_switch (uint64_t *save_rsp, uint64_t next_rsp,
+		struct intr_frame *next_tf);
+
+/* Resumes the next thread as context_switch() does, without
+ * saving anything about the running one. */
+void context_restore (uint64_t next_rsp, struct intr_frame *next_tf)
+	__attribute__ ((noreturn));
+
+#endif /* threads/switch.h */
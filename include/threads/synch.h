@@ -1,52 +1,88 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/lockstat.h"
+#include "threads/spinlock.h"
 
 /* A counting semaphore. */
 struct semaphore {
+	struct spinlock lock;       /* Protects the members below. */
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
+	unsigned next_seq;          /* Keeps equal-priority waiters in FIFO order. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t timeout);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+heap_less_func waiter_more;
+
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct heap_elem held_elem; /* Element in the holder's held locks. */
+	struct lockstat stat;       /* Contention statistics. */
 };
 
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
+bool lock_acquire_timeout (struct lock *, int64_t timeout);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
 void donate_priority(void);
-void remove_with_lock(struct lock * lock);
 void refresh_priority(void);
+bool lock_more (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+
+/* Reader-writer lock.  Any number of threads may hold it shared,
+   or a single thread exclusive.  A waiting writer keeps new
+   readers out, and waiting threads donate their priority to
+   every current holder. */
+struct rwlock {
+	struct spinlock lock;       /* Protects the members below. */
+	struct thread *writer;      /* Thread holding it exclusive, or null. */
+	struct list readers;        /* Threads holding it shared. */
+	struct list read_waiters;   /* Threads waiting to read. */
+	struct list write_waiters;  /* Threads waiting to write. */
+	struct lockstat stat;       /* Contention statistics. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_init_named (struct rwlock *, const char *name);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiters, highest priority on top. */
+	unsigned next_seq;          /* Keeps equal-priority waiters in FIFO order. */
 };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t timeout);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
 
 /* Custom print function*/
 void list_print_elem(struct list *list);
-void list_print_dona_elem(struct list *list);
 
 /* Optimization barrier.
  *
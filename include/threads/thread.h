@@ -2,8 +2,11 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <rusage.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
@@ -29,6 +32,16 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the MLFQS. */
+#define NICE_MIN -20                    /* Nicest to others. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
+/* Stride scheduler tickets. */
+#define TICKETS_MIN 1                   /* Smallest share. */
+#define TICKETS_DEFAULT 100             /* Default share. */
+#define TICKETS_MAX 1000                /* Largest share. */
+
 /* fd constants */
 #define FD_MIN    2
 #define FD_MAX    128
@@ -100,16 +113,32 @@ struct thread {
 	char name[16];                      /* Name (for debugging purposes). */
 	int exit_status;		 			// 종료 상태 0~255, -1 ? 
 	int priority;                       /* Priority. */
-	int wakeup_tick;
-	int init_priority;   				// donation 이후 우선순위를 초기화하기 위해 초기값 저장
-	
-	struct file *fd_array[FD_MAX];
+	int64_t wakeup_tick;                /* Tick to wake up at, if sleeping. */
+	struct heap_elem sleep_elem;        /* Element in the sleep queue. */
+	bool timed_wait;                    /* Blocked with a deadline? */
+	bool timed_out;                     /* Woken by the deadline? */
+	int base_priority;                  /* Priority before donations. */
+	int nice;                           /* Niceness, for the MLFQS. */
+	fixed_t recent_cpu;                 /* Recent CPU usage, for the MLFQS. */
+	int tickets;                        /* Share, for the stride scheduler. */
+	int64_t pass;                       /* Virtual time, for the stride scheduler. */
+	struct heap_elem stride_elem;       /* Element in the stride run queue. */
+	struct cpu *cpu;                    /* CPU it is queued on or runs on. */
+	struct list_elem all_elem;          /* Element in the list of all threads. */
+	struct rusage usage;                /* CPU and scheduling statistics. */
+	int64_t ready_since;                /* Tick at which it became ready. */
 	
 	struct file *current_file;
 	
 	struct lock *wait_on_lock; 		// 해당 스레드가 대기 하고있는 lock자료구조의 주소 저장
-	struct list donations; 			// multiple donation 을 고려하기 위해 사용 
-	struct list_elem donation_elem; // multiple donation 을 고려하기 위해 사용
+	struct heap held_locks;             /* Locks held, by priority they lend. */
+	int rw_priority;                    /* Priority lent through rwlocks. */
+	struct rwlock *rw_read;             /* Reader-writer lock held shared. */
+	struct list_elem rw_elem;           /* Element in that lock's readers. */
+	struct heap_elem wait_elem;         /* Element in a semaphore's waiters. */
+	unsigned wait_seq;                  /* Arrival order among the waiters. */
+	struct heap *wait_heap;             /* Wait queue ordered by our priority. */
+	struct heap_elem *wait_node;        /* Our element in WAIT_HEAP. */
 	
 	struct thread *my_parent;		// 이 쓰레드(자식)가 create되는 순간의 running thread를 저장
 	struct child_info *my_info;		// 엄마가 볼 내 정보를 적어둔 구조체의 주소
@@ -121,19 +150,19 @@ struct thread {
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
-#endif
-#ifdef VM
-	/* Table for whole virtual memory owned by thread. */
-	struct supplemental_page_table spt;
+	struct process *process;            /* User process, or null. */
+	int stack_slot;                     /* User stack slot, or -1 if main. */
 #endif
 
 	/* Owned by thread.c. */
 	struct intr_frame tf;               /* Information for switching */
+	uint64_t switch_rsp;                /* Saved stack pointer, or 0. */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
 struct child_info {						// 내가 죽을 때 그 정볼르 명시적으로 남겨서 부모가 후에 볼 수 있게하기 위함
 	bool is_zombie;						// 내(자식)가 죽으면 zombie true로 바꿔둘 것임 
+	bool is_thread;                     /* Made by thread_spawn(), not fork()? */
 	tid_t tid;							// 내(자식)의 tid
 	int exit_status;					// 내(자식)가 exit()으로 죽을때 인자로 전달받은 exit status
 	struct list_elem elem_c;			// child_info를 list_elem을 사용해서 child_list(연결리스트)로 관리
@@ -141,24 +170,60 @@ struct child_info {						// 내가 죽을 때 그 정볼르 명시적으로 남
 	struct thread *child_thread;		// 내(자식) 주소
 };
 
+/* Cache that child_info structures are allocated from. */
+extern struct kmem_cache *child_info_cache;
+
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride scheduler, which gives each thread a
+   share of the CPU proportional to its tickets.  Controlled by
+   kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* If true (default), switch between threads with context_switch(),
+   which saves only the callee-saved registers.  If false, save
+   the whole intr_frame on every switch.  For benchmarking. */
+extern bool thread_fast_switch;
+
+/* If true, print each process's resource usage when it exits.
+   Controlled by kernel command-line option "-rusage". */
+extern bool thread_report_usage;
+
+/* If true, record scheduler events in the trace buffer and dump
+   it at shutdown.  Controlled by kernel command-line option
+   "-trace". */
+extern bool thread_trace_enabled;
+
+/* Maximum number of dead threads' pages kept for reuse.
+   Controlled by kernel command-line option "-tcache=N". */
+extern size_t thread_cache_max;
+
+/* Scheduler trace events. */
+enum trace_type {
+	TRACE_SWITCH_OUT,       /* Thread stopped running; ARG is its status. */
+	TRACE_SWITCH_IN,        /* Thread started running; ARG is previous tid. */
+	TRACE_BLOCK,            /* Thread blocked itself. */
+	TRACE_UNBLOCK,          /* Thread made ready; ARG is its priority. */
+	TRACE_WAKEUP,           /* Sleeping thread woke up; ARG is tick due. */
+	TRACE_DONATE,           /* Thread received priority ARG by donation. */
+};
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_print_usage (struct thread *);
+void thread_trace (enum trace_type, struct thread *, int arg);
+void thread_trace_dump (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
-bool cmp_priority (struct list_elem *a, struct list_elem *b, void* aux);
-bool cmp_priority_dona (struct list_elem *a, struct list_elem *b, void* aux);
-bool cmp_priority_waiter (struct list_elem *a, struct list_elem *b, void* aux);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -171,6 +236,7 @@ void thread_exit (void) NO_RETURN;
 void thread_yield (void);
 void thread_osiete (int64_t ticks);
 void thread_sleep (void);
+bool thread_block_until (int64_t deadline);
 void thread_awake (int64_t ticks);
 
 void update_next_tick_to_awake(int64_t ticks);
@@ -178,8 +244,12 @@ int64_t get_next_tick_to_awake(void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *, int priority);
+void test_max_priority (void);
 
 int thread_get_nice (void);
+int thread_set_tickets (int);
+int thread_get_tickets (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
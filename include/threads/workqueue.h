@@ -0,0 +1,72 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <heap.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Deferred work.
+
+   A work item is a function and an argument that one of a small
+   pool of kernel worker threads calls later, in thread context,
+   where it may sleep, take locks and do I/O.  Interrupt handlers
+   and other code that must not block queue work instead of
+   doing it inline.
+
+   An item is queued at one of WORK_PRI_CNT priorities, and the
+   workers always take the oldest item of the highest priority
+   first, running it at the thread priority for its level.  It
+   may also be queued with a delay, in timer ticks, after which
+   the timer interrupt moves it to its run queue.
+
+   An item is either idle, pending (delayed or queued) or being
+   run by a worker.  Queueing an item that is already pending
+   does nothing, so an item runs at most once per queueing, but
+   it may be queued again, even from its own function, while it
+   is running.  The memory for the item belongs to the caller,
+   who must not free or reinitialize it while it is pending. */
+
+/* Function called by a worker, given the item's AUX. */
+typedef void work_func (void *aux);
+
+/* Work priorities, highest first. */
+enum work_priority {
+	WORK_HIGH,                  /* Completing I/O and the like. */
+	WORK_NORMAL,                /* Ordinary deferred work. */
+	WORK_LOW,                   /* Background work that can wait. */
+	WORK_PRI_CNT
+};
+
+/* States of a work item. */
+enum work_state {
+	WORK_IDLE,                  /* Not pending. */
+	WORK_DELAYED,               /* Waiting for its tick. */
+	WORK_QUEUED                 /* On a run queue. */
+};
+
+/* A work item. */
+struct work {
+	work_func *func;            /* Function to call. */
+	void *aux;                  /* Its argument. */
+	enum work_priority priority; /* Run queue to use. */
+	enum work_state state;      /* Pending state. */
+	int64_t due;                /* Tick at which a delayed item is queued. */
+	struct list_elem elem;      /* Run queue element. */
+	struct heap_elem delay_elem; /* Delayed work heap element. */
+};
+
+void workqueue_init (void);
+void workqueue_tick (int64_t now);
+int64_t workqueue_next_due (void);
+void workqueue_flush (void);
+
+void work_init (struct work *, work_func *, void *aux, enum work_priority);
+bool work_queue (struct work *);
+bool work_queue_delayed (struct work *, int64_t ticks);
+bool work_pending (const struct work *);
+bool work_cancel (struct work *);
+void work_flush (struct work *);
+bool work_cancel_sync (struct work *);
+
+#endif /* threads/workqueue.h */
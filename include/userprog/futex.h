@@ -0,0 +1,11 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+void futex_init (void);
+int futex_wait (int *uaddr, int expected, int64_t timeout);
+int futex_wake (int *uaddr, int cnt);
+void futex_wake_all (uint64_t *pml4);
+
+#endif /* userprog/futex.h */
@@ -1,13 +1,60 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <stdint.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/* Maximum number of threads in a user process, counting the
+   main thread.  Each thread_spawn()ed thread gets a stack slot. */
+#define PROCESS_THREAD_MAX 32
+
+/* Pages in the user stack of a thread_spawn()ed thread.  The
+   slots lie below the main thread's stack, each followed by an
+   unmapped guard page. */
+#define THREAD_STACK_PAGES 8
+
+/* State shared by the threads of a user process.
+
+   The main thread, the one that fork() or the initial exec
+   created, owns it.  Other threads come from thread_spawn() and
+   share the address space, the page table and the file table.
+   When the main thread exits it first waits for the others to
+   exit, so the process is torn down once, by the last thread.
+
+   exit(), or being killed, ends the whole process, whichever
+   thread it happens in: the process is marked as exiting, and
+   every other thread exits the next time it would return to
+   user mode.  Threads asleep on a futex are woken for it.  A
+   thread_spawn()ed thread can leave on its own with
+   thread_quit(), which in the main thread is the same as
+   exit(). */
+struct process {
+	struct thread *main;                /* Main thread. */
+	struct lock lock;                   /* Protects the members below. */
+	struct condition threads_done;      /* Signaled as threads exit. */
+	int thread_cnt;                     /* Threads that have not exited. */
+	bool exiting;                       /* Is the whole process exiting? */
+	int exit_status;                    /* Its exit status, once exiting. */
+	uint32_t stack_slots;               /* Stack slots in use, as a bitmap. */
+	struct file *fd_array[FD_MAX];      /* Open files, by descriptor. */
+#ifdef VM
+	struct supplemental_page_table spt; /* Pages of the address space. */
+	struct work writeback;              /* Writes back dirty mmap pages. */
+#endif
+};
 
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
+void process_terminate (int status) NO_RETURN;
+bool process_exiting (void);
 void process_activate (struct thread *next);
 
+tid_t process_spawn (void *entry, void *func, void *aux);
+int process_join (tid_t);
+
 #endif /* userprog/process.h */
@@ -3,6 +3,12 @@
 
 void syscall_init (void);
 
-struct lock filesys_lock;
+/* Serializes the file system.  Calls that only read (file reads,
+   filesize, tell, faulting in file pages) take it shared; every
+   call that can change an inode, a directory, the open inode
+   list or a file's position takes it exclusive.  read() is the
+   exception: it moves the position under the shared lock, and
+   file_read() serializes that with a lock of the file's own. */
+struct rwlock filesys_lock;
 
 #endif /* userprog/syscall.h */
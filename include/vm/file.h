@@ -20,9 +20,13 @@ struct args_lazy_mm {
 	unsigned *mmap_cnt;
 };
 
+/* Cache that args_lazy_mm structures are allocated from. */
+extern struct kmem_cache *args_lazy_mm_cache;
+
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+void mmap_writeback (void *proc_);
 #endif
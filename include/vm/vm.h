@@ -4,6 +4,7 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "threads/mmu.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "lib/kernel/list.h"
 #include "lib/kernel/hash.h"
@@ -108,6 +109,7 @@ struct page_operations {
  * All designs up to you for this. */
 struct supplemental_page_table {
 	// struct list list_spt;
+	struct lock lock;           /* Protects PAGES from the process's threads. */
 	struct hash pages;
 };
 
@@ -118,6 +120,12 @@ struct frame_table {
 
 struct frame_table ft;
 
+/* Caches that pages, frames and lazy-load arguments are
+   allocated from.  Created by vm_init(). */
+extern struct kmem_cache *page_cache;
+extern struct kmem_cache *frame_cache;
+extern struct kmem_cache *args_lazy_cache;
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -11,8 +11,8 @@
    that can generate 32-bit x86 code without having any of the
    necessary libraries, including libgcc.  Thus, we can make
    Pintos work on these machines by simply implementing our own
-   64-bit division routines, which are the only routines from
-   libgcc that Pintos requires.
+   64-bit division routines and population count, which are the
+   only routines from libgcc that Pintos requires.
 
    Completeness is another reason to include these routines.  If
    Pintos is completely self-contained, then that makes it that
@@ -145,6 +145,7 @@ long long __divdi3 (long long n, long long d);
 long long __moddi3 (long long n, long long d);
 unsigned long long __udivdi3 (unsigned long long n, unsigned long long d);
 unsigned long long __umoddi3 (unsigned long long n, unsigned long long d);
+int __popcountdi2 (unsigned long long x);
 
 /* Signed 64-bit division. */
 long long
@@ -169,3 +170,13 @@ unsigned long long
 __umoddi3 (unsigned long long n, unsigned long long d) {
 	return umod64 (n, d);
 }
+
+/* Number of 1 bits in X, for __builtin_popcountl() on CPUs that
+   may lack the POPCNT instruction. */
+int
+__popcountdi2 (unsigned long long x) {
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (x * 0x0101010101010101ULL) >> 56;
+}
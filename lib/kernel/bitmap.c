@@ -23,10 +23,18 @@ typedef unsigned long elem_type;
 
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   Bitmaps are mostly used as allocators, scanned for a run of
+   false bits that is then flipped to true, and they tend to fill
+   up from the front.  FREE_HINT is a lower bound on the first
+   false bit, so that bitmap_scan_and_flip() need not look at the
+   full words before it again and again.  It is raised by
+   bitmap_scan_and_flip() and lowered whenever a bit is reset. */
 struct bitmap {
 	size_t bit_cnt;     /* Number of bits. */
 	elem_type *bits;    /* Elements that represent bits. */
+	size_t free_hint;   /* No bit before this one is false. */
 };
 
 /* Returns the index of the element that contains the bit
@@ -62,6 +70,51 @@ last_mask (const struct bitmap *b) {
 	int last_bits = b->bit_cnt % ELEM_BITS;
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns a bit mask in which the bits of BIT_IDX's element at
+   and after BIT_IDX are set to 1 and the rest are set to 0. */
+static inline elem_type
+head_mask (size_t bit_idx) {
+	return ~(bit_mask (bit_idx) - 1);
+}
+
+/* Returns a bit mask in which the bits of the element holding
+   bit END - 1 that come before END are set to 1 and the rest are
+   set to 0. */
+static inline elem_type
+tail_mask (size_t end) {
+	return end % ELEM_BITS ? bit_mask (end) - 1 : (elem_type) -1;
+}
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+
+   Works an element at a time: elements in which every bit is
+   !VALUE are skipped with a single comparison, and the first bit
+   of interest in any other one is found with a count of trailing
+   zeros. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, size_t end, bool value) {
+	elem_type flip = value ? 0 : (elem_type) -1;
+	size_t idx, last;
+	elem_type word;
+
+	if (start >= end)
+		return end;
+
+	idx = elem_idx (start);
+	last = elem_idx (end - 1);
+	word = (b->bits[idx] ^ flip) & head_mask (start);
+	for (;;) {
+		if (idx == last)
+			word &= tail_mask (end);
+		if (word != 0)
+			return idx * ELEM_BITS + __builtin_ctzl (word);
+		if (idx == last)
+			return end;
+		word = b->bits[++idx] ^ flip;
+	}
+}
 
 /* Creation and destruction. */
 
@@ -75,6 +128,7 @@ bitmap_create (size_t bit_cnt) {
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
 		b->bits = malloc (byte_cnt (bit_cnt));
+		b->free_hint = 0;
 		if (b->bits != NULL || bit_cnt == 0) {
 			bitmap_set_all (b, false);
 			return b;
@@ -95,6 +149,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
 
 	b->bit_cnt = bit_cnt;
 	b->bits = (elem_type *) (b + 1);
+	b->free_hint = 0;
 	bitmap_set_all (b, false);
 	return b;
 }
@@ -160,6 +215,8 @@ bitmap_reset (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the AND instruction in [IA32-v2a]. */
 	asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	if (bit_idx < b->free_hint)
+		b->free_hint = bit_idx;
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -174,6 +231,8 @@ bitmap_flip (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the XOR instruction in [IA32-v2b]. */
 	asm ("lock xorq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	if (bit_idx < b->free_hint)
+		b->free_hint = bit_idx;
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -194,50 +253,77 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, but not the group as a
+   whole. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	size_t end = start + cnt;
+	size_t idx, last;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	if (cnt == 0)
+		return;
+
+	last = elem_idx (end - 1);
+	for (idx = elem_idx (start); idx <= last; idx++) {
+		elem_type mask = (elem_type) -1;
+
+		if (idx == elem_idx (start))
+			mask &= head_mask (start);
+		if (idx == last)
+			mask &= tail_mask (end);
+
+		/* See bitmap_mark() and bitmap_reset(). */
+		if (value)
+			asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	}
+	if (!value && start < b->free_hint)
+		b->free_hint = start;
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t end = start + cnt;
+	size_t idx, last, true_cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	if (cnt == 0)
+		return 0;
+
+	true_cnt = 0;
+	last = elem_idx (end - 1);
+	for (idx = elem_idx (start); idx <= last; idx++) {
+		elem_type word = b->bits[idx];
+
+		if (idx == elem_idx (start))
+			word &= head_mask (start);
+		if (idx == last)
+			word &= tail_mask (end);
+		true_cnt += __builtin_popcountl (word);
+	}
+	return value ? true_cnt : cnt - true_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return next_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -272,12 +358,25 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
+	if (cnt == 0)
+		return start;
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
+		size_t i = start;
+
+		/* Hop from each run of VALUE bits to the next, rather than
+		   trying every starting bit in turn. */
+		while (i <= last) {
+			size_t end;
+
+			i = next_bit (b, i, last + 1, value);
+			if (i > last)
+				break;
+			end = next_bit (b, i, i + cnt, !value);
+			if (end == i + cnt)
 				return i;
+			i = end;
+		}
 	}
 	return BITMAP_ERROR;
 }
@@ -291,9 +390,22 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    setting them. */
 size_t
 bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t idx = bitmap_scan (b, start, cnt, value);
-	if (idx != BITMAP_ERROR)
+	bool use_hint = !value && cnt > 0 && start <= b->free_hint;
+	size_t idx;
+
+	/* Every bit from START to the hint is true, so begin at the
+	   first false bit at or after the hint, and remember it. */
+	if (use_hint) {
+		start = next_bit (b, b->free_hint, b->bit_cnt, false);
+		b->free_hint = start;
+	}
+
+	idx = bitmap_scan (b, start, cnt, value);
+	if (idx != BITMAP_ERROR) {
 		bitmap_set_multiple (b, idx, cnt, !value);
+		if (use_hint && idx == b->free_hint)
+			b->free_hint = idx + cnt;
+	}
 	return idx;
 }
 
@@ -315,6 +427,7 @@ bitmap_read (struct bitmap *b, struct file *file) {
 		off_t size = byte_cnt (b->bit_cnt);
 		success = file_read_at (file, b->bits, size, 0) == size;
 		b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+		b->free_hint = 0;
 	}
 	return success;
 }
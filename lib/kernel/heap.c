@@ -0,0 +1,172 @@
+/* Pairing heap.
+
+   See heap.h for basic information.  The heap is a tree in which
+   every node orders before its children.  Each node keeps a
+   pointer to its leftmost child, and siblings are chained in a
+   doubly linked list whose head points back at the parent, so
+   that an arbitrary node can be cut out of the tree in O(1). */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *,
+		struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes heap H to order elements using LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->elem_cnt = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into heap H. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->child = e->next = e->prev = NULL;
+	h->root = meld (h, h->root, e);
+	h->elem_cnt++;
+}
+
+/* Returns the element at the top of H, or a null pointer if H
+   is empty. */
+struct heap_elem *
+heap_top (struct heap *h) {
+	ASSERT (h != NULL);
+
+	return h->root;
+}
+
+/* Removes and returns the element at the top of H, or returns a
+   null pointer if H is empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *top;
+
+	ASSERT (h != NULL);
+
+	top = h->root;
+	if (top != NULL) {
+		h->root = merge_pairs (h, top->child);
+		h->elem_cnt--;
+		top->child = NULL;
+	}
+	return top;
+}
+
+/* Removes E, which must be in heap H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		heap_pop (h);
+		return;
+	}
+
+	/* Cut E and its subtree out of the tree. */
+	ASSERT (e->prev != NULL);
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+
+	/* Put E's children back. */
+	h->root = meld (h, h->root, merge_pairs (h, e->child));
+	h->elem_cnt--;
+	e->child = NULL;
+}
+
+/* Restores the heap order of H after the key of E, which must
+   be in H, has changed. */
+void
+heap_update (struct heap *h, struct heap_elem *e) {
+	heap_remove (h, e);
+	heap_push (h, e);
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (struct heap *h) {
+	return h->root == NULL;
+}
+
+/* Links the roots A and B, either of which may be null, and
+   returns the root of the combined tree. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	ASSERT (a->next == NULL && a->prev == NULL);
+	ASSERT (b->next == NULL && b->prev == NULL);
+
+	if (h->less (b, a, h->aux)) {
+		struct heap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	/* Make B the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Combines the sibling list starting at FIRST into a single tree
+   with the standard two-pass pairing and returns its root. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* Left to right, meld siblings in pairs, stacking the results
+	   through their `next' members. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = first->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+
+		a = meld (h, a, b);
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* Right to left, meld the pairs into one tree. */
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (h, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
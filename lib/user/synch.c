@@ -0,0 +1,118 @@
+#include <synch.h>
+#include <debug.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* The mutex follows the three-state design from Ulrich Drepper's
+   "Futexes Are Tricky": a thread that finds the mutex locked
+   marks it contended (2) before sleeping, and only an unlock
+   that sees the contended mark enters the kernel to wake a
+   waiter.  Uncontended lock and unlock are one atomic
+   instruction each. */
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m) {
+	m->state = 0;
+}
+
+/* Locks M, sleeping until it becomes available if necessary. */
+void
+mutex_lock (struct mutex *m) {
+	int c = 0;
+
+	if (__atomic_compare_exchange_n (&m->state, &c, 1, false,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	/* Contended.  Whoever holds M will see the 2 and wake us up.
+	   Because we cannot tell whether anyone else is still asleep,
+	   keep the mark when we do get M. */
+	if (c != 2)
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		futex_wait (&m->state, 2, -1);
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+/* Locks M if it is available and returns true, or returns false
+   without waiting. */
+bool
+mutex_trylock (struct mutex *m) {
+	int c = 0;
+
+	return __atomic_compare_exchange_n (&m->state, &c, 1, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Unlocks M, which the caller must hold. */
+void
+mutex_unlock (struct mutex *m) {
+	if (__atomic_exchange_n (&m->state, 0, __ATOMIC_RELEASE) == 2)
+		futex_wake (&m->state, 1);
+}
+
+/* Locks M for a thread that has just slept on a condition
+   variable.  Other threads may still be waiting for M, so M is
+   always marked contended. */
+static void
+mutex_lock_contended (struct mutex *m) {
+	while (__atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE) != 0)
+		futex_wait (&m->state, 2, -1);
+}
+
+/* Initializes CV. */
+void
+condvar_init (struct condvar *cv) {
+	cv->seq = 0;
+	cv->waiters = 0;
+}
+
+/* Atomically unlocks M, which the caller must hold, and waits
+   for CV to be signaled, then locks M again before returning.
+   As with any condition variable, the caller must recheck its
+   condition after waking up. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m) {
+	condvar_timedwait (cv, m, -1);
+}
+
+/* Like condvar_wait(), but gives up after TIMEOUT timer ticks
+   if TIMEOUT is not negative.  Returns false if it timed out,
+   true otherwise. */
+bool
+condvar_timedwait (struct condvar *cv, struct mutex *m, int64_t timeout) {
+	int seq = __atomic_load_n (&cv->seq, __ATOMIC_RELAXED);
+	int result;
+
+	/* A signal that comes after we read SEQ changes it, so
+	   futex_wait() below returns at once instead of missing it. */
+	cv->waiters++;
+	mutex_unlock (m);
+	result = futex_wait (&cv->seq, seq, timeout);
+	mutex_lock_contended (m);
+	cv->waiters--;
+
+	return result != 1;
+}
+
+/* Wakes up one thread waiting on CV, if any.  M, the mutex used
+   with CV, must be held. */
+void
+condvar_signal (struct condvar *cv, struct mutex *m UNUSED) {
+	if (cv->waiters > 0) {
+		__atomic_fetch_add (&cv->seq, 1, __ATOMIC_RELEASE);
+		futex_wake (&cv->seq, 1);
+	}
+}
+
+/* Wakes up all threads waiting on CV.  M, the mutex used with
+   CV, must be held. */
+void
+condvar_broadcast (struct condvar *cv, struct mutex *m UNUSED) {
+	if (cv->waiters > 0) {
+		__atomic_fetch_add (&cv->seq, 1, __ATOMIC_RELEASE);
+		futex_wake (&cv->seq, INT_MAX);
+	}
+}
@@ -199,3 +199,50 @@ umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
 
+int
+getrusage (struct rusage *usage) {
+	return syscall1 (SYS_GETRUSAGE, usage);
+}
+
+int
+set_tickets (int tickets) {
+	return syscall1 (SYS_SET_TICKETS, tickets);
+}
+
+int
+futex_wait (int *addr, int expected, int64_t timeout) {
+	return syscall3 (SYS_FUTEX_WAIT, addr, expected, timeout);
+}
+
+int
+futex_wake (int *addr, int cnt) {
+	return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* Where a thread_spawn()ed thread starts: runs FUNC (AUX) and
+   exits the thread with its return value. */
+static void
+thread_start (int (*func) (void *), void *aux) {
+	thread_quit (func (aux));
+}
+
+tid_t
+thread_spawn (int (*func) (void *), void *aux) {
+	return syscall3 (SYS_THREAD_SPAWN, thread_start, func, aux);
+}
+
+int
+thread_join (tid_t tid) {
+	return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_quit (int status) {
+	syscall1 (SYS_THREAD_QUIT, status);
+	NOT_REACHED ();
+}
+
+int
+clock_gettime (int clock_id, struct timespec *ts) {
+	return syscall2 (SYS_CLOCK_GETTIME, clock_id, ts);
+}
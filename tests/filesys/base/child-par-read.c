@@ -0,0 +1,52 @@
+/* Child process for par-read test.
+   Reads the whole test file as many times as its second argument
+   says, a chunk at a time, and compares every chunk against the
+   expected contents. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/par-read.h"
+
+const char *test_name = "child-par-read";
+
+static char buf[BUF_SIZE];
+static char chunk[CHUNK_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  int child_idx;
+  int pass_cnt;
+  int pass;
+  int fd;
+
+  quiet = true;
+  
+  CHECK (argc == 3, "argc must be 3, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  pass_cnt = atoi (argv[2]);
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (pass = 0; pass < pass_cnt; pass++) 
+    {
+      size_t ofs;
+
+      seek (fd, 0);
+      for (ofs = 0; ofs < sizeof buf; ofs += CHUNK_SIZE)
+        {
+          CHECK (read (fd, chunk, CHUNK_SIZE) == CHUNK_SIZE,
+                 "read \"%s\"", file_name);
+          compare_bytes (chunk, buf + ofs, CHUNK_SIZE, ofs, file_name);
+        }
+      CHECK (tell (fd) == sizeof buf, "tell \"%s\"", file_name);
+    }
+  close (fd);
+
+  return child_idx;
+}
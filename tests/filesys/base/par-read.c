@@ -0,0 +1,79 @@
+/* Has 1, 2, 4, and then 8 child processes read the same file at
+   the same time, a chunk at a time, and makes sure that every
+   read returns what was written.  Each time, the readers share
+   PASS_CNT passes over the file between them, so the total
+   amount read stays the same, and the time taken is reported.
+   Readers share the file system lock, so with more readers their
+   reads should overlap instead of queuing up behind one
+   another. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/par-read.h"
+
+static char buf[BUF_SIZE];
+
+static const size_t reader_cnts[] = {1, 2, 4, MAX_READERS};
+
+static int64_t
+to_us (const struct timespec *ts) 
+{
+  return ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+/* Starts READER_CNT readers, each making PASS_CNT / READER_CNT
+   passes over the file, waits for them, and reports how long
+   they took. */
+static void
+run_readers (size_t reader_cnt) 
+{
+  pid_t children[MAX_READERS];
+  struct timespec start, end;
+  size_t i;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < reader_cnt; i++) 
+    {
+      char cmd_line[128];
+
+      snprintf (cmd_line, sizeof cmd_line, "child-par-read %zu %zu",
+                i, PASS_CNT / reader_cnt);
+      if ((children[i] = fork ("child-par-read")))
+        {
+          if (children[i] == PID_ERROR)
+            fail ("fork child %zu of %zu", i + 1, reader_cnt);
+        }
+      else
+        {
+          exec (cmd_line);
+          fail ("exec \"%s\"", cmd_line);
+        }
+    }
+  for (i = 0; i < reader_cnt; i++)
+    if (wait (children[i]) != (int) i)
+      fail ("child %zu of %zu failed", i + 1, reader_cnt);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  msg ("%zu readers: %d bytes in %lld us", reader_cnt, PASS_CNT * BUF_SIZE,
+       (long long) (to_us (&end) - to_us (&start)));
+}
+
+void
+test_main (void) 
+{
+  size_t i;
+  int fd;
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) > 0, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  for (i = 0; i < sizeof reader_cnts / sizeof *reader_cnts; i++)
+    run_readers (reader_cnts[i]);
+}
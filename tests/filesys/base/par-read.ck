@@ -0,0 +1,37 @@
+# -*- perl -*-
+
+# The expected output looks like this:
+#
+# (par-read) begin
+# (par-read) create "shared"
+# (par-read) open "shared"
+# (par-read) write "shared"
+# (par-read) close "shared"
+# (par-read) 1 readers: 131072 bytes in 412000 us
+# (par-read) 2 readers: 131072 bytes in 230000 us
+# (par-read) 4 readers: 131072 bytes in 151000 us
+# (par-read) 8 readers: 131072 bytes in 120000 us
+# (par-read) end
+#
+# The times depend on the host, so only the shape of the output
+# is checked.  A reader that reads the wrong data fails the test.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+foreach my $line ('(par-read) begin', '(par-read) create "shared"',
+		  '(par-read) open "shared"', '(par-read) write "shared"',
+		  '(par-read) close "shared"', '(par-read) end') {
+    fail "Missing \"$line\"\n" if !grep (index ($_, $line) == 0, @output);
+}
+foreach my $cnt (1, 2, 4, 8) {
+    fail "Missing timing for $cnt readers\n"
+      if !grep (/^\(par-read\) $cnt readers: 131072 bytes in \d+ us/, @output);
+}
+pass;
@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_BASE_PAR_READ_H
+#define TESTS_FILESYS_BASE_PAR_READ_H
+
+#define BUF_SIZE 8192
+#define CHUNK_SIZE 512
+#define PASS_CNT 16             /* Passes over the file, split among readers. */
+#define MAX_READERS 8           /* Must divide PASS_CNT. */
+static const char file_name[] = "shared";
+
+#endif /* tests/filesys/base/par-read.h */
@@ -0,0 +1,247 @@
+/* Test program and benchmark for lib/kernel/bitmap.c.
+
+   Checks bitmap_count(), bitmap_contains() and bitmap_scan()
+   against straightforward bit-at-a-time versions on random
+   bitmaps.  Then checks bitmap_scan_and_flip() the same way
+   while random resets, flips and multi-bit sets free bits
+   behind its hint of where the first false bit is, and compares
+   how many cycles a scan takes each way on a sparse map, where
+   most bits are free, and on a dense one, where the free bits
+   are few and far between.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <intrinsic.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of bits in a bitmap that we will test. */
+#define MAX_BITS 1000
+
+/* Number of bits in each benchmark map. */
+#define BENCH_BITS 65536
+
+/* Number of scans timed on each benchmark map. */
+#define BENCH_SCANS 100
+
+static void fill_random (struct bitmap *, int percent);
+static size_t slow_count (const struct bitmap *, size_t start, size_t cnt,
+                          bool);
+static size_t slow_scan (const struct bitmap *, size_t start, size_t cnt,
+                         bool);
+static void verify (const struct bitmap *);
+static void verify_flip (struct bitmap *);
+static void check_hint (void);
+static void benchmark (const char *name, int percent);
+
+/* Test the bitmap implementation. */
+void
+test (void)
+{
+  size_t bit_cnt;
+
+  printf ("testing various size bitmaps:");
+  for (bit_cnt = 0; bit_cnt < MAX_BITS; bit_cnt = bit_cnt * 4 / 3 + 1)
+    {
+      struct bitmap *b = bitmap_create (bit_cnt);
+      int percent;
+
+      ASSERT (b != NULL);
+      printf (" %zu", bit_cnt);
+      for (percent = 0; percent <= 100; percent += 10)
+        {
+          fill_random (b, percent);
+          verify (b);
+          verify_flip (b);
+        }
+      bitmap_destroy (b);
+    }
+  printf (" done\n");
+  check_hint ();
+
+  benchmark ("sparse", 1);
+  benchmark ("dense", 99);
+  printf ("bitmap: PASS\n");
+}
+
+/* Sets each bit in B to true with a chance of PERCENT in 100. */
+static void
+fill_random (struct bitmap *b, int percent)
+{
+  size_t i;
+
+  for (i = 0; i < bitmap_size (b); i++)
+    bitmap_set (b, i, random_ulong () % 100 < (unsigned) percent);
+}
+
+/* Returns the number of bits in B between START and START + CNT,
+   exclusive, that are set to VALUE, one bit at a time. */
+static size_t
+slow_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i, value_cnt = 0;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test (b, start + i) == value)
+      value_cnt++;
+  return value_cnt;
+}
+
+/* Returns the start of the first group of CNT bits in B at or
+   after START that are all VALUE, trying each bit in turn. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    if (slow_count (b, i, cnt, value) == cnt)
+      return i;
+  return BITMAP_ERROR;
+}
+
+/* Checks the multiple-bit functions on B against the slow
+   versions, over a few random ranges. */
+static void
+verify (const struct bitmap *b)
+{
+  size_t bit_cnt = bitmap_size (b);
+  int i;
+
+  for (i = 0; i < 16; i++)
+    {
+      size_t start = random_ulong () % (bit_cnt + 1);
+      size_t cnt = random_ulong () % (bit_cnt - start + 1);
+      size_t run = random_ulong () % 8;
+      bool value = i % 2;
+      size_t value_cnt = slow_count (b, start, cnt, value);
+
+      ASSERT (bitmap_count (b, start, cnt, value) == value_cnt);
+      ASSERT (bitmap_contains (b, start, cnt, value) == (value_cnt > 0));
+      ASSERT (bitmap_scan (b, start, run, value)
+              == slow_scan (b, start, run, value));
+    }
+}
+
+/* Checks bitmap_scan_and_flip() on B against slow_scan() while
+   other calls change B at random in between.  Most scans start
+   at bit 0 for false bits, the case that uses and moves B's
+   hint, and most of the changes free bits, often behind it. */
+static void
+verify_flip (struct bitmap *b)
+{
+  size_t bit_cnt = bitmap_size (b);
+  int i;
+
+  if (bit_cnt == 0)
+    return;
+  for (i = 0; i < 64; i++)
+    {
+      size_t start = random_ulong () % (bit_cnt + 1);
+      size_t cnt = random_ulong () % (bit_cnt - start + 1);
+      size_t idx, expected;
+      bool value;
+
+      switch (random_ulong () % 4)
+        {
+        case 0:
+          bitmap_reset (b, random_ulong () % bit_cnt);
+          break;
+        case 1:
+          bitmap_flip (b, random_ulong () % bit_cnt);
+          break;
+        case 2:
+          bitmap_set_multiple (b, start, cnt % 8, random_ulong () % 4 == 0);
+          break;
+        case 3:
+          if (random_ulong () % 4 != 0)
+            start = 0;
+          cnt = random_ulong () % 8;
+          value = random_ulong () % 4 == 0;
+          expected = slow_scan (b, start, cnt, value);
+          idx = bitmap_scan_and_flip (b, start, cnt, value);
+          ASSERT (idx == expected);
+          if (idx != BITMAP_ERROR)
+            {
+              ASSERT (slow_count (b, idx, cnt, !value) == cnt);
+            }
+          break;
+        }
+    }
+}
+
+/* Checks that each way of freeing a bit behind the hint that
+   bitmap_scan_and_flip() keeps makes the next scan find it. */
+static void
+check_hint (void)
+{
+  struct bitmap *b = bitmap_create (200);
+  size_t i;
+
+  ASSERT (b != NULL);
+
+  /* Allocating bits 0...99 leaves the hint at 100. */
+  for (i = 0; i < 100; i++)
+    ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == i);
+
+  bitmap_reset (b, 37);
+  ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == 37);
+  bitmap_flip (b, 12);
+  ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == 12);
+  bitmap_set_multiple (b, 50, 3, false);
+  ASSERT (bitmap_scan_and_flip (b, 0, 3, false) == 50);
+  bitmap_set (b, 99, false);
+  ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == 99);
+  ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == 100);
+
+  /* A scan from past the hint must not move it forward. */
+  bitmap_reset (b, 5);
+  ASSERT (bitmap_scan_and_flip (b, 150, 1, false) == 150);
+  ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == 5);
+  ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == 101);
+
+  bitmap_destroy (b);
+}
+
+/* Times scans for a single false bit, from the start of a map in
+   which PERCENT percent of bits are true, both ways. */
+static void
+benchmark (const char *name, int percent)
+{
+  struct bitmap *b = bitmap_create (BENCH_BITS);
+  uint64_t fast = 0, slow = 0;
+  size_t found = 0;
+  int i;
+
+  ASSERT (b != NULL);
+  fill_random (b, percent);
+  for (i = 0; i < BENCH_SCANS; i++)
+    {
+      size_t start = random_ulong () % BENCH_BITS;
+      uint64_t t0, t1, t2;
+      size_t idx;
+
+      t0 = rdtsc ();
+      idx = bitmap_scan (b, start, 1, false);
+      t1 = rdtsc ();
+      ASSERT (slow_scan (b, start, 1, false) == idx);
+      t2 = rdtsc ();
+
+      fast += t1 - t0;
+      slow += t2 - t1;
+      if (idx != BITMAP_ERROR)
+        found++;
+    }
+  printf ("%s map (%d%% set): %zu of %d scans found a bit, "
+          "%llu cycles per word-wise scan, %llu per bit-wise scan\n",
+          name, percent, found, BENCH_SCANS,
+          (unsigned long long) (fast / BENCH_SCANS),
+          (unsigned long long) (slow / BENCH_SCANS));
+  bitmap_destroy (b);
+}
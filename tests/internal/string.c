@@ -0,0 +1,177 @@
+/* Test program and benchmark for the memory functions in
+   lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), memcmp() and strlen()
+   against bytewise versions at every combination of alignments,
+   then reports the bytes per cycle that each one achieves on
+   8-byte, 512-byte and 4 kB blocks.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <intrinsic.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Largest block that we will test or time. */
+#define MAX_SIZE 4096
+
+/* Times each function is called for one measurement. */
+#define BENCH_REPS 256
+
+static unsigned char src[MAX_SIZE + 16];
+static unsigned char dst[MAX_SIZE + 16];
+static unsigned char ref[MAX_SIZE + 16];
+
+static void randomize (void);
+static void verify (size_t size, size_t src_ofs, size_t dst_ofs);
+static void report (const char *name, size_t size, uint64_t cycles);
+static void benchmark (size_t size);
+
+/* Test and time the memory functions. */
+void
+test (void)
+{
+  static const size_t sizes[] = {0, 1, 7, 8, 9, 63, 127, 128, 129, 1000,
+                                 MAX_SIZE};
+  static const size_t bench_sizes[] = {8, 512, MAX_SIZE};
+  size_t i;
+
+  printf ("testing various size blocks:");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t src_ofs, dst_ofs;
+
+      printf (" %zu", sizes[i]);
+      for (src_ofs = 0; src_ofs < 8; src_ofs++)
+        for (dst_ofs = 0; dst_ofs < 8; dst_ofs++)
+          verify (sizes[i], src_ofs, dst_ofs);
+    }
+  printf (" done\n");
+
+  for (i = 0; i < sizeof bench_sizes / sizeof *bench_sizes; i++)
+    benchmark (bench_sizes[i]);
+  printf ("string: PASS\n");
+}
+
+/* Fills SRC and DST with different random bytes and copies DST
+   to REF. */
+static void
+randomize (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof src; i++)
+    {
+      src[i] = random_ulong ();
+      dst[i] = ref[i] = random_ulong ();
+    }
+}
+
+/* Checks each function on SIZE-byte blocks at SRC + SRC_OFS and
+   DST + DST_OFS. */
+static void
+verify (size_t size, size_t src_ofs, size_t dst_ofs)
+{
+  size_t i;
+
+  /* memcpy(). */
+  randomize ();
+  for (i = 0; i < size; i++)
+    ref[dst_ofs + i] = src[src_ofs + i];
+  ASSERT (memcpy (dst + dst_ofs, src + src_ofs, size) == dst + dst_ofs);
+  for (i = 0; i < sizeof dst; i++)
+    ASSERT (dst[i] == ref[i]);
+
+  /* memcmp(), with a difference in the last byte, if any. */
+  ASSERT (memcmp (dst + dst_ofs, src + src_ofs, size) == 0);
+  if (size > 0)
+    {
+      dst[dst_ofs + size - 1]++;
+      ASSERT ((memcmp (dst + dst_ofs, src + src_ofs, size) > 0)
+              == (dst[dst_ofs + size - 1] > src[src_ofs + size - 1]));
+    }
+
+  /* memmove(), within SRC, in whichever direction the offsets
+     make it go. */
+  if (size + 8 <= MAX_SIZE)
+    {
+      randomize ();
+      for (i = 0; i < sizeof src; i++)
+        ref[i] = src[i];
+      for (i = 0; i < size; i++)
+        ref[dst_ofs + i] = src[src_ofs + i];
+      ASSERT (memmove (src + dst_ofs, src + src_ofs, size) == src + dst_ofs);
+      for (i = 0; i < sizeof src; i++)
+        ASSERT (src[i] == ref[i]);
+    }
+
+  /* memset(). */
+  randomize ();
+  for (i = 0; i < size; i++)
+    ref[dst_ofs + i] = 0xa5;
+  ASSERT (memset (dst + dst_ofs, 0xa5, size) == dst + dst_ofs);
+  for (i = 0; i < sizeof dst; i++)
+    ASSERT (dst[i] == ref[i]);
+
+  /* strlen(). */
+  for (i = 0; i < size; i++)
+    src[src_ofs + i] = random_ulong () % 255 + 1;
+  src[src_ofs + size] = '\0';
+  ASSERT (strlen ((char *) src + src_ofs) == size);
+}
+
+/* Prints the bytes per cycle, in hundredths, of BENCH_REPS runs
+   of a function over SIZE bytes that took CYCLES cycles. */
+static void
+report (const char *name, size_t size, uint64_t cycles)
+{
+  uint64_t rate = (uint64_t) size * BENCH_REPS * 100 / (cycles + 1);
+
+  printf ("%s, %zu bytes: %llu.%02llu bytes/cycle\n", name, size,
+          (unsigned long long) (rate / 100),
+          (unsigned long long) (rate % 100));
+}
+
+/* Times each function on aligned SIZE-byte blocks. */
+static void
+benchmark (size_t size)
+{
+  uint64_t start;
+  int i;
+
+  randomize ();
+  memset (src, 'x', size);
+  src[size] = '\0';
+  memcpy (dst, src, size);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_REPS; i++)
+    memcpy (dst, src, size);
+  report ("memcpy", size, rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_REPS; i++)
+    memmove (dst + 8, dst, size);
+  report ("memmove", size, rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_REPS; i++)
+    memset (dst, 'x', size);
+  report ("memset", size, rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_REPS; i++)
+    ASSERT (memcmp (dst, src, size) == 0);
+  report ("memcmp", size, rdtsc () - start);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_REPS; i++)
+    ASSERT (strlen ((char *) src) == size);
+  report ("strlen", size, rdtsc () - start);
+}
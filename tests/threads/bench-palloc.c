@@ -0,0 +1,137 @@
+/* Measures how long palloc_get_page() and palloc_get_multiple()
+   take as the user pool fills up.
+
+   The benchmark first takes every page in the user pool, which
+   nothing else uses in the threads tests, then frees pages in
+   random order until the pool is 95%, 50% and finally 10% full.
+   Freeing at random leaves the free pages scattered, the worst
+   case for a first-fit scan.  At each occupancy it times
+   ALLOC_CNT single-page allocations, which the per-CPU magazines
+   mostly serve, and then RUN_CNT allocations each of 2, 4 and 8
+   contiguous pages, which always go to the buddy allocator, and
+   gives the pages back.  A multi-page allocation may fail when
+   the pool is nearly full, so the number that succeeded is
+   reported along with the time. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define ALLOC_CNT 64
+#define RUN_CNT 16
+
+static void time_runs (int occupancy, size_t page_cnt);
+static void shuffle (void **, size_t cnt);
+
+void
+test_bench_palloc (void)
+{
+  static const int occupancies[] = {95, 50, 10};
+  static const size_t run_pages[] = {2, 4, 8};
+  void *fresh[ALLOC_CNT];
+  void **pages;
+  void *head = NULL, *page;
+  size_t page_cnt, used;
+  unsigned i, k;
+  int j;
+
+  /* Take every page in the user pool, chaining them together
+     through their first word since we do not know how many there
+     are yet. */
+  for (page_cnt = 0; (page = palloc_get_page (PAL_USER)) != NULL;
+       page_cnt++)
+    {
+      *(void **) page = head;
+      head = page;
+    }
+  if (page_cnt < 2 * ALLOC_CNT)
+    fail ("user pool too small to measure");
+
+  pages = malloc (page_cnt * sizeof *pages);
+  if (pages == NULL)
+    fail ("out of memory");
+  for (used = 0; used < page_cnt; used++)
+    {
+      pages[used] = head;
+      head = *(void **) head;
+    }
+
+  random_init (0);
+  shuffle (pages, page_cnt);
+  for (i = 0; i < sizeof occupancies / sizeof *occupancies; i++)
+    {
+      size_t target = page_cnt * occupancies[i] / 100;
+      uint64_t start, cycles;
+
+      while (used > target && used > ALLOC_CNT)
+        palloc_free_page (pages[--used]);
+
+      start = timer_cycles ();
+      for (j = 0; j < ALLOC_CNT; j++)
+        fresh[j] = palloc_get_page (PAL_USER);
+      cycles = timer_cycles () - start;
+
+      for (j = 0; j < ALLOC_CNT; j++)
+        {
+          if (fresh[j] == NULL)
+            fail ("palloc_get_page() failed at %d%% occupancy",
+                  occupancies[i]);
+          palloc_free_page (fresh[j]);
+        }
+
+      msg ("%d%% full: %llu cycles/page", occupancies[i],
+           (unsigned long long) (cycles / ALLOC_CNT));
+
+      for (k = 0; k < sizeof run_pages / sizeof *run_pages; k++)
+        time_runs (occupancies[i], run_pages[k]);
+    }
+
+  while (used > 0)
+    palloc_free_page (pages[--used]);
+  free (pages);
+}
+
+/* Times RUN_CNT allocations of PAGE_CNT contiguous pages with
+   the pool at OCCUPANCY percent, then frees them. */
+static void
+time_runs (int occupancy, size_t page_cnt)
+{
+  void *runs[RUN_CNT];
+  uint64_t start, cycles;
+  int found = 0;
+  int i;
+
+  start = timer_cycles ();
+  for (i = 0; i < RUN_CNT; i++)
+    runs[i] = palloc_get_multiple (PAL_USER, page_cnt);
+  cycles = timer_cycles () - start;
+
+  for (i = 0; i < RUN_CNT; i++)
+    if (runs[i] != NULL)
+      {
+        palloc_free_multiple (runs[i], page_cnt);
+        found++;
+      }
+
+  msg ("%d%% full: %llu cycles/%zu-page run, %d of %d found",
+       occupancy, (unsigned long long) (cycles / RUN_CNT), page_cnt,
+       found, RUN_CNT);
+}
+
+/* Puts the CNT elements of ARRAY in random order. */
+static void
+shuffle (void **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = cnt; i > 1; i--)
+    {
+      size_t j = random_ulong () % i;
+      void *t = array[i - 1];
+      array[i - 1] = array[j];
+      array[j] = t;
+    }
+}
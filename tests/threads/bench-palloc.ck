@@ -0,0 +1,34 @@
+# -*- perl -*-
+
+# The expected output looks like this:
+#
+# (bench-palloc) 95% full: 310 cycles/page
+# (bench-palloc) 95% full: 2210 cycles/2-page run, 16 of 16 found
+# (bench-palloc) 95% full: 2480 cycles/4-page run, 9 of 16 found
+# (bench-palloc) 95% full: 1930 cycles/8-page run, 2 of 16 found
+# (bench-palloc) 50% full: 295 cycles/page
+# ...
+# (bench-palloc) 10% full: 1120 cycles/8-page run, 16 of 16 found
+#
+# The cycle counts depend on the host, so only the shape of the
+# output is checked.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+foreach my $pct (95, 50, 10) {
+    fail "Missing measurement at $pct% occupancy\n"
+      if !grep (/ $pct% full: \d+ cycles\/page/, @output);
+    foreach my $run (2, 4, 8) {
+	fail "Missing $run-page measurement at $pct% occupancy\n"
+	  if !grep (/ $pct% full: \d+ cycles\/$run-page run, \d+ of \d+ found/,
+		    @output);
+    }
+}
+pass;
@@ -0,0 +1,97 @@
+/* Measures how many context switches per second two kernel
+   threads can make by bouncing between a pair of semaphores.
+
+   The main thread ups PING and downs PONG, and the partner thread
+   does the opposite, so every round trip is two switches.  The
+   benchmark runs once with the full intr_frame switch and once
+   with the callee-saved-only switch, for BENCH_TICKS timer ticks
+   each, and reports both rates. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define BENCH_TICKS 100
+
+struct ping_pong
+  {
+    struct semaphore ping;
+    struct semaphore pong;
+    struct semaphore done;
+    bool stop;
+  };
+
+static thread_func pong_thread;
+static void measure (const char *name, bool fast);
+
+void
+test_bench_switch (void)
+{
+  bool old_fast = thread_fast_switch;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  measure ("full", false);
+  measure ("fast", true);
+  thread_fast_switch = old_fast;
+}
+
+static void
+measure (const char *name, bool fast)
+{
+  struct ping_pong pp;
+  int64_t start, elapsed;
+  uint64_t start_tsc, cycles;
+  long long rounds = 0;
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  sema_init (&pp.done, 0);
+  pp.stop = false;
+  thread_fast_switch = fast;
+
+  if (thread_create ("pong", PRI_DEFAULT, pong_thread, &pp) == TID_ERROR)
+    fail ("couldn't create pong thread");
+
+  /* Start on a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+
+  start = timer_ticks ();
+  start_tsc = timer_cycles ();
+  while ((elapsed = timer_elapsed (start)) < BENCH_TICKS)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+      rounds++;
+    }
+  cycles = timer_cycles () - start_tsc;
+
+  pp.stop = true;
+  sema_up (&pp.ping);
+  sema_down (&pp.done);
+
+  msg ("%s: %lld switches/s, %llu cycles/switch", name,
+       rounds * 2 * TIMER_FREQ / elapsed,
+       (unsigned long long) (rounds > 0 ? cycles / (rounds * 2) : 0));
+}
+
+static void
+pong_thread (void *pp_)
+{
+  struct ping_pong *pp = pp_;
+
+  for (;;)
+    {
+      sema_down (&pp->ping);
+      if (pp->stop)
+        break;
+      sema_up (&pp->pong);
+    }
+  sema_up (&pp->done);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+
+# The expected output looks like this:
+#
+# (bench-switch) full: 912345 switches/s, 2410 cycles/switch
+# (bench-switch) fast: 1523456 switches/s, 1380 cycles/switch
+#
+# The rates depend on the host, so only the shape of the output
+# is checked.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+foreach my $mode ('full', 'fast') {
+    fail "Missing measurement for $mode switch\n"
+      if !grep (/ $mode: \d+ switches\/s, \d+ cycles\/switch/, @output);
+}
+pass;
@@ -0,0 +1,94 @@
+/* Measures the cost of waking up a thread as the number of
+   threads already sitting in the ready queue grows.
+
+   The main thread runs at PRI_MAX, so nothing else gets to run
+   while it measures.  For each round it fills the ready queue
+   with READY_CNT filler threads at PRI_MIN + 2, then wakes
+   WAKE_CNT worker threads at PRI_MIN + 1 that were left blocked
+   on their own semaphores beforehand.  Every wakeup has to queue
+   the worker behind all of the fillers, so a scheduler that keeps
+   a single sorted ready list pays O(READY_CNT) per wakeup,
+   whereas per-priority run queues keep the cost flat.  At the
+   end of a round the main thread drops to PRI_MIN so that the
+   fillers and workers can run and exit. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WAKE_CNT 64
+
+static thread_func filler_thread;
+static thread_func worker_thread;
+
+static const int ready_cnts[] = {0, 16, 256, 1024, 2048};
+
+void
+test_bench_wakeup (void)
+{
+  struct semaphore *wake;
+  size_t r;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  wake = malloc (sizeof *wake * WAKE_CNT);
+  if (wake == NULL)
+    fail ("couldn't allocate semaphores");
+
+  for (r = 0; r < sizeof ready_cnts / sizeof *ready_cnts; r++)
+    {
+      uint64_t start, cycles;
+      int ready, i;
+
+      thread_set_priority (PRI_MAX);
+
+      for (i = 0; i < WAKE_CNT; i++)
+        {
+          sema_init (&wake[i], 0);
+          if (thread_create ("worker", PRI_MIN + 1, worker_thread, &wake[i])
+              == TID_ERROR)
+            fail ("couldn't create worker thread %d", i);
+        }
+
+      /* Let every worker block on its semaphore. */
+      thread_set_priority (PRI_MIN);
+      thread_set_priority (PRI_MAX);
+
+      for (ready = 0; ready < ready_cnts[r]; ready++)
+        if (thread_create ("filler", PRI_MIN + 2, filler_thread, NULL)
+            == TID_ERROR)
+          break;
+
+      start = timer_cycles ();
+      for (i = 0; i < WAKE_CNT; i++)
+        sema_up (&wake[i]);
+      cycles = timer_cycles () - start;
+
+      msg ("ready=%d: %llu cycles/wakeup", ready,
+           (unsigned long long) (cycles / WAKE_CNT));
+
+      /* Drain the fillers and the workers. */
+      thread_set_priority (PRI_MIN);
+    }
+
+  thread_set_priority (PRI_DEFAULT);
+  free (wake);
+}
+
+static void
+filler_thread (void *aux UNUSED)
+{
+}
+
+static void
+worker_thread (void *wake_)
+{
+  struct semaphore *wake = wake_;
+
+  sema_down (wake);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+
+# The expected output looks like this:
+#
+# (bench-wakeup) ready=0: 412 cycles/wakeup
+# (bench-wakeup) ready=16: 409 cycles/wakeup
+# (bench-wakeup) ready=256: 415 cycles/wakeup
+# (bench-wakeup) ready=1024: 411 cycles/wakeup
+# (bench-wakeup) ready=2048: 418 cycles/wakeup
+#
+# The cycle counts depend on the host, so only the shape of the
+# output is checked.  The fewer filler threads fit in memory, the
+# smaller the last ready counts may be.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@rounds) = grep (/ready=\d+: \d+ cycles\/wakeup/, @output);
+fail "Expected 5 measurements but found " . scalar (@rounds) . "\n"
+  if @rounds != 5;
+pass;
@@ -0,0 +1,70 @@
+/* Allocates blocks of every size up to a few pages, including
+   the medium classes whose blocks straddle page boundaries, and
+   checks that they do not overlap, that realloc() keeps their
+   contents, and that freeing them in another order works. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+
+#define MAX_SIZE 5000
+#define STEP 13
+
+static void *blocks[MAX_SIZE / STEP + 1];
+
+static bool check_fill (const uint8_t *, size_t size, uint8_t value);
+
+void
+test_malloc_classes (void) 
+{
+  size_t size;
+  int i, cnt = 0;
+
+  for (size = 1; size <= MAX_SIZE; size += STEP)
+    {
+      uint8_t *p = malloc (size);
+      if (p == NULL)
+        fail ("malloc(%zu) failed.", size);
+      if ((uintptr_t) p % 8 != 0)
+        fail ("malloc(%zu) returned misaligned %p.", size, p);
+      memset (p, cnt, size);
+      blocks[cnt++] = p;
+    }
+  for (i = 0, size = 1; i < cnt; i++, size += STEP)
+    if (!check_fill (blocks[i], size, i))
+      fail ("Block of %zu bytes was overwritten.", size);
+  msg ("%d blocks allocated without overlap.", cnt);
+
+  for (i = 0, size = 1; i < cnt; i++, size += STEP)
+    {
+      uint8_t *p = realloc (blocks[i], size * 2);
+      if (p == NULL)
+        fail ("realloc() to %zu bytes failed.", size * 2);
+      if (!check_fill (p, size, i))
+        fail ("realloc() lost the contents of a %zu-byte block.", size);
+      blocks[i] = p;
+    }
+  msg ("realloc() kept the contents.");
+
+  /* Free the odd blocks first, then the even ones, so that arenas
+     empty out at different times. */
+  for (i = 1; i < cnt; i += 2)
+    free (blocks[i]);
+  for (i = 0; i < cnt; i += 2)
+    free (blocks[i]);
+  msg ("All blocks freed.");
+}
+
+/* Returns true if the SIZE bytes at P all equal VALUE. */
+static bool
+check_fill (const uint8_t *p, size_t size, uint8_t value) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != value)
+      return false;
+  return true;
+}
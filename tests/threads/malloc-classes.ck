@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-classes) begin
+(malloc-classes) 385 blocks allocated without overlap.
+(malloc-classes) realloc() kept the contents.
+(malloc-classes) All blocks freed.
+(malloc-classes) end
+EOF
+pass;
@@ -0,0 +1,62 @@
+/* Checks that PAL_ZERO pages are zeroed whether they come from
+   the pool of pages zeroed in the background or are zeroed on
+   the spot: dirties some pages, gives the idle thread time to
+   zero free pages, and then takes more PAL_ZERO pages than the
+   background pool holds.  The allocator's counters must show
+   that some of those pages were zeroed ahead of time, since
+   memset() on request alone would also pass the content check. */
+
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define DIRTY_CNT 32
+#define PAGE_CNT 100
+
+static void *pages[PAGE_CNT];
+
+void
+test_palloc_zero (void) 
+{
+  long long hits_before, misses_before, hits, misses;
+  int i;
+  size_t j;
+
+  for (i = 0; i < DIRTY_CNT; i++)
+    {
+      pages[i] = palloc_get_page (PAL_USER);
+      if (pages[i] == NULL)
+        fail ("palloc_get_page() failed.");
+      memset (pages[i], 0xa5, PGSIZE);
+    }
+  for (i = 0; i < DIRTY_CNT; i++)
+    palloc_free_page (pages[i]);
+
+  /* Let the idle thread run. */
+  timer_sleep (10);
+
+  palloc_zero_stats (PAL_USER, &hits_before, &misses_before);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      const char *p = pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (p == NULL)
+        fail ("palloc_get_page() failed.");
+      for (j = 0; j < PGSIZE; j++)
+        if (p[j] != 0)
+          fail ("Byte %zu of page %d is not zero.", j, i);
+    }
+  msg ("%d PAL_ZERO pages were zeroed.", PAGE_CNT);
+
+  palloc_zero_stats (PAL_USER, &hits, &misses);
+  if (hits + misses - hits_before - misses_before != PAGE_CNT)
+    fail ("%lld PAL_ZERO pages counted, expected %d.",
+          hits + misses - hits_before - misses_before, PAGE_CNT);
+  if (hits == hits_before)
+    fail ("No PAL_ZERO page came from the background-zeroed pool.");
+  msg ("Some PAL_ZERO pages were zeroed in the background.");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+}
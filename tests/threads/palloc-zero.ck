@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) 100 PAL_ZERO pages were zeroed.
+(palloc-zero) Some PAL_ZERO pages were zeroed in the background.
+(palloc-zero) end
+EOF
+pass;
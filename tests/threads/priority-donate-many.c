@@ -0,0 +1,111 @@
+/* A low-priority thread holds a lock while 300 threads, with
+   priorities spread over the whole range and many of them equal,
+   queue up for it.  The holder must run at the priority of its
+   highest waiter, the lock must then be handed out in priority
+   order, first come first served among equal priorities, and the
+   holder must get its own priority back once it lets go. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define WAITER_CNT 300
+
+struct waiter
+  {
+    int idx;                    /* Creation order. */
+    int priority;               /* Priority. */
+  };
+
+static struct lock lock;
+static struct semaphore go;
+static struct waiter waiters[WAITER_CNT];
+static int order[WAITER_CNT];
+static int order_cnt;
+
+static thread_func holder_thread;
+static thread_func waiter_thread;
+
+void
+test_priority_donate_many (void) 
+{
+  int max_priority = PRI_MIN;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  sema_init (&go, 0);
+  order_cnt = 0;
+
+  thread_set_priority (PRI_MAX);
+  thread_create ("holder", PRI_MIN + 1, holder_thread, NULL);
+
+  /* Let the holder take the lock and wait for GO. */
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_MAX);
+
+  for (i = 0; i < WAITER_CNT; i++)
+    {
+      struct waiter *w = &waiters[i];
+      char name[16];
+
+      w->idx = i;
+      w->priority = PRI_MIN + 2 + i * 37 % (PRI_MAX - PRI_MIN - 2);
+      if (w->priority > max_priority)
+        max_priority = w->priority;
+      snprintf (name, sizeof name, "waiter %d", i);
+      if (thread_create (name, w->priority, waiter_thread, w) == TID_ERROR)
+        fail ("couldn't create waiter %d", i);
+
+      /* Let the waiter block on the lock. */
+      thread_set_priority (PRI_MIN);
+      thread_set_priority (PRI_MAX);
+    }
+  msg ("%d threads waiting for the lock.", WAITER_CNT);
+  msg ("Holder should have priority %d.", max_priority);
+
+  /* Everybody else runs before we get back. */
+  sema_up (&go);
+  thread_set_priority (PRI_MIN);
+
+  if (order_cnt != WAITER_CNT)
+    fail ("%d of %d waiters got the lock", order_cnt, WAITER_CNT);
+  for (i = 1; i < WAITER_CNT; i++)
+    {
+      const struct waiter *a = &waiters[order[i - 1]];
+      const struct waiter *b = &waiters[order[i]];
+
+      if (a->priority < b->priority
+          || (a->priority == b->priority && a->idx > b->idx))
+        fail ("waiter %d (priority %d) got the lock before "
+              "waiter %d (priority %d)",
+              a->idx, a->priority, b->idx, b->priority);
+    }
+  msg ("Lock handed out in priority order.");
+  thread_set_priority (PRI_DEFAULT);
+}
+
+static void
+holder_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  sema_down (&go);
+  msg ("Holder has priority %d.", thread_get_priority ());
+  lock_release (&lock);
+  msg ("Holder should have priority %d.  Actual priority: %d.",
+       PRI_MIN + 1, thread_get_priority ());
+}
+
+static void
+waiter_thread (void *w_) 
+{
+  struct waiter *w = w_;
+
+  lock_acquire (&lock);
+  order[order_cnt++] = w->idx;
+  lock_release (&lock);
+}
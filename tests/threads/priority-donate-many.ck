@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-many) begin
+(priority-donate-many) 300 threads waiting for the lock.
+(priority-donate-many) Holder should have priority 62.
+(priority-donate-many) Holder has priority 62.
+(priority-donate-many) Holder should have priority 1.  Actual priority: 1.
+(priority-donate-many) Lock handed out in priority order.
+(priority-donate-many) end
+EOF
+pass;
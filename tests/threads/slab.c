@@ -0,0 +1,81 @@
+/* Checks the object caches: objects do not overlap and are
+   aligned, the constructor runs once per object rather than
+   once per allocation, and a freed object comes back in its
+   constructed state. */
+
+#include <stdint.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 200
+#define OBJ_MAGIC 0x0b1ec7
+
+/* A test object.  The constructor sets MAGIC. */
+struct obj
+  {
+    int magic;
+    char data[92];
+  };
+
+static int ctor_cnt;
+
+static kmem_ctor obj_ctor;
+
+void
+test_slab (void) 
+{
+  struct kmem_cache *cache;
+  struct obj *objs[OBJ_CNT];
+  struct obj *again;
+  int i, cnt;
+
+  cache = kmem_cache_create ("test", sizeof (struct obj), obj_ctor);
+  if (cache == NULL)
+    fail ("kmem_cache_create() failed.");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("kmem_cache_alloc() failed.");
+      if ((uintptr_t) objs[i] % 8 != 0)
+        fail ("Object %p is misaligned.", objs[i]);
+      if (objs[i]->magic != OBJ_MAGIC)
+        fail ("Object %d was not constructed.", i);
+      memset (objs[i]->data, i, sizeof objs[i]->data);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    for (cnt = 0; cnt < (int) sizeof objs[i]->data; cnt++)
+      if (objs[i]->data[cnt] != (char) i || objs[i]->magic != OBJ_MAGIC)
+        fail ("Object %d was overwritten.", i);
+  msg ("%d objects allocated without overlap.", OBJ_CNT);
+
+  if (ctor_cnt < OBJ_CNT)
+    fail ("Constructor ran %d times for %d objects.", ctor_cnt, OBJ_CNT);
+  cnt = ctor_cnt;
+  kmem_cache_free (cache, objs[OBJ_CNT / 2]);
+  again = kmem_cache_alloc (cache);
+  if (ctor_cnt != cnt)
+    fail ("Constructor ran again on allocation.");
+  msg ("Constructor ran once per object.");
+
+  if (again != objs[OBJ_CNT / 2])
+    fail ("Freed object was not reused.");
+  if (again->magic != OBJ_MAGIC)
+    fail ("Reused object lost its constructed state.");
+  msg ("Freed object was reused in its constructed state.");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  kmem_cache_destroy (cache);
+}
+
+static void
+obj_ctor (void *obj_) 
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  ctor_cnt++;
+}
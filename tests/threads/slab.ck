@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab) begin
+(slab) 200 objects allocated without overlap.
+(slab) Constructor ran once per object.
+(slab) Freed object was reused in its constructed state.
+(slab) end
+EOF
+pass;
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Each thread should get a share of the 600 ticks proportional to
+# its tickets, give or take a few time slices.
+my ($maxdiff) = 30;
+my ($found) = 0;
+foreach (@output) {
+    my ($id, $tickets, $ticks)
+      = /Thread (\d+) with (\d+) tickets received (\d+) ticks\./ or next;
+    my ($expected) = 600 * $tickets / (100 + 200 + 300);
+    fail "Thread $id received $ticks ticks, expected $expected "
+      . "(+/- $maxdiff).\n"
+      if abs ($ticks - $expected) > $maxdiff;
+    $found++;
+}
+fail "Expected 3 threads but found $found.\n" if $found != 3;
+pass;
@@ -0,0 +1,111 @@
+/* Checks sema_down_timeout(), lock_acquire_timeout() and
+   cond_wait_timeout(): each gives up after its timeout, succeeds
+   if woken in time, and a lock waiter that gives up stops
+   donating its priority to the holder.  A lock released just as
+   a waiter's timeout expires must go to that waiter rather than
+   be lost. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func waiter_func;
+static thread_func signaler_func;
+static thread_func late_waiter_func;
+
+static struct lock lock;
+static struct condition cond;
+static struct semaphore late_done;
+static volatile int64_t late_deadline;
+
+void
+test_synch_timeout (void) 
+{
+  struct semaphore sema;
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  start = timer_ticks ();
+  if (sema_down_timeout (&sema, 10))
+    fail ("sema_down_timeout() took a zero semaphore.");
+  if (timer_elapsed (start) < 10)
+    fail ("sema_down_timeout() gave up after only %"PRId64" ticks.",
+          timer_elapsed (start));
+  msg ("sema_down_timeout() timed out.");
+  sema_up (&sema);
+  if (!sema_down_timeout (&sema, 10))
+    fail ("sema_down_timeout() missed a positive semaphore.");
+  msg ("sema_down_timeout() got the semaphore.");
+
+  lock_init (&lock);
+  lock_acquire (&lock);
+  thread_create ("waiter", PRI_DEFAULT + 10, waiter_func, NULL);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+  timer_sleep (20);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+
+  cond_init (&cond);
+  if (cond_wait_timeout (&cond, &lock, 10))
+    fail ("cond_wait_timeout() was signaled by nobody.");
+  if (!lock_held_by_current_thread (&lock))
+    fail ("cond_wait_timeout() returned without the lock.");
+  msg ("cond_wait_timeout() timed out with the lock held.");
+  thread_create ("signaler", PRI_DEFAULT - 1, signaler_func, NULL);
+  if (!cond_wait_timeout (&cond, &lock, 1000))
+    fail ("cond_wait_timeout() missed the signal.");
+  msg ("cond_wait_timeout() was signaled.");
+
+  /* Let a lower-priority waiter time out, then release the lock
+     before it gets to run again. */
+  sema_init (&late_done, 0);
+  late_deadline = INT64_MAX;
+  thread_create ("late waiter", PRI_DEFAULT - 1, late_waiter_func, NULL);
+  timer_sleep (2);
+  while (timer_ticks () < late_deadline)
+    barrier ();
+  lock_release (&lock);
+  sema_down (&late_done);
+  if (!lock_acquire_timeout (&lock, 10))
+    fail ("the lock was lost after the late waiter released it.");
+  msg ("Main thread got the lock back.");
+  lock_release (&lock);
+}
+
+static void
+waiter_func (void *aux UNUSED) 
+{
+  if (lock_acquire_timeout (&lock, 10))
+    fail ("waiter got a lock that is never released.");
+  msg ("waiter: lock_acquire_timeout() timed out.");
+}
+
+static void
+late_waiter_func (void *aux UNUSED) 
+{
+  late_deadline = timer_ticks () + 10;
+  if (!lock_acquire_timeout (&lock, 10))
+    fail ("late waiter timed out on a lock released at its deadline.");
+  msg ("late waiter: lock_acquire_timeout() got the lock.");
+  lock_release (&lock);
+  sema_up (&late_done);
+}
+
+static void
+signaler_func (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  cond_signal (&cond, &lock);
+  lock_release (&lock);
+}
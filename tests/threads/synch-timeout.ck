@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(synch-timeout) begin
+(synch-timeout) sema_down_timeout() timed out.
+(synch-timeout) sema_down_timeout() got the semaphore.
+(synch-timeout) Main thread should have priority 41.  Actual priority: 41.
+(synch-timeout) waiter: lock_acquire_timeout() timed out.
+(synch-timeout) Main thread should have priority 31.  Actual priority: 31.
+(synch-timeout) cond_wait_timeout() timed out with the lock held.
+(synch-timeout) cond_wait_timeout() was signaled.
+(synch-timeout) late waiter: lock_acquire_timeout() got the lock.
+(synch-timeout) Main thread got the lock back.
+(synch-timeout) end
+EOF
+pass;
@@ -25,10 +25,20 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-many", test_priority_donate_many},
+    {"synch-timeout", test_synch_timeout},
+    {"workqueue", test_workqueue},
+    {"slab", test_slab},
+    {"malloc-classes", test_malloc_classes},
+    {"palloc-zero", test_palloc_zero},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"bench-wakeup", test_bench_wakeup},
+    {"bench-switch", test_bench_switch},
+    {"bench-palloc", test_bench_palloc},
+    {"stride-fair", test_stride_fair},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -19,10 +19,20 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_many;
+extern test_func test_synch_timeout;
+extern test_func test_workqueue;
+extern test_func test_slab;
+extern test_func test_malloc_classes;
+extern test_func test_palloc_zero;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_bench_wakeup;
+extern test_func test_bench_switch;
+extern test_func test_bench_palloc;
+extern test_func test_stride_fair;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,129 @@
+/* Checks the kernel work queues: queued work runs in priority
+   order at the priority of its level, delayed work waits for
+   its tick, cancelled work does not run, and the flush
+   functions wait for work to finish, even work that keeps
+   queueing itself. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+/* Record of the order in which work ran. */
+struct run_record
+  {
+    const char *name;
+    int priority;
+  };
+
+static struct run_record runs[3];
+static int run_cnt;
+
+static int64_t ran_at;
+static bool slow_done;
+static int requeue_cnt;
+static struct work requeue_work;
+
+static work_func record_func;
+static work_func tick_func;
+static work_func slow_func;
+static work_func requeue_func;
+
+void
+test_workqueue (void) 
+{
+  struct work low, normal, high, delayed, slow;
+  int64_t start;
+  int i, cnt;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  work_init (&low, record_func, "low", WORK_LOW);
+  work_init (&normal, record_func, "normal", WORK_NORMAL);
+  work_init (&high, record_func, "high", WORK_HIGH);
+  work_queue (&low);
+  work_queue (&normal);
+  work_queue (&high);
+  if (work_queue (&high))
+    fail ("work_queue() queued pending work twice.");
+  workqueue_flush ();
+  if (run_cnt != 3)
+    fail ("%d work items ran, expected 3.", run_cnt);
+  for (i = 0; i < run_cnt; i++)
+    msg ("%s ran at priority %d.", runs[i].name, runs[i].priority);
+
+  work_init (&delayed, tick_func, NULL, WORK_NORMAL);
+  start = timer_ticks ();
+  work_queue_delayed (&delayed, 10);
+  timer_sleep (20);
+  if (ran_at == 0)
+    fail ("Delayed work never ran.");
+  if (ran_at - start < 10)
+    fail ("Delayed work ran after only %d ticks.", (int) (ran_at - start));
+  msg ("Delayed work ran on time.");
+
+  ran_at = 0;
+  work_queue_delayed (&delayed, 10);
+  if (!work_cancel (&delayed))
+    fail ("work_cancel() missed delayed work.");
+  work_queue (&delayed);
+  if (!work_cancel (&delayed))
+    fail ("work_cancel() missed queued work.");
+  if (work_cancel (&delayed))
+    fail ("work_cancel() cancelled idle work.");
+  timer_sleep (20);
+  if (ran_at != 0)
+    fail ("Cancelled work ran.");
+  msg ("Cancelled work did not run.");
+
+  work_init (&slow, slow_func, NULL, WORK_NORMAL);
+  work_queue (&slow);
+  work_flush (&slow);
+  if (!slow_done)
+    fail ("work_flush() returned before the work finished.");
+  msg ("work_flush() waited for the work to finish.");
+
+  work_init (&requeue_work, requeue_func, NULL, WORK_NORMAL);
+  work_queue (&requeue_work);
+  timer_sleep (10);
+  work_cancel_sync (&requeue_work);
+  cnt = requeue_cnt;
+  timer_sleep (10);
+  if (cnt == 0 || requeue_cnt != cnt || work_pending (&requeue_work))
+    fail ("work_cancel_sync() did not stop self-requeueing work.");
+  msg ("Self-requeueing work stopped.");
+}
+
+static void
+record_func (void *name) 
+{
+  runs[run_cnt].name = name;
+  runs[run_cnt].priority = thread_get_priority ();
+  run_cnt++;
+}
+
+static void
+tick_func (void *aux UNUSED) 
+{
+  ran_at = timer_ticks ();
+}
+
+static void
+slow_func (void *aux UNUSED) 
+{
+  timer_sleep (5);
+  slow_done = true;
+}
+
+static void
+requeue_func (void *aux UNUSED) 
+{
+  requeue_cnt++;
+  work_queue_delayed (&requeue_work, 1);
+}
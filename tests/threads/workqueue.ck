@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) high ran at priority 32.
+(workqueue) normal ran at priority 31.
+(workqueue) low ran at priority 30.
+(workqueue) Delayed work ran on time.
+(workqueue) Cancelled work did not run.
+(workqueue) work_flush() waited for the work to finish.
+(workqueue) Self-requeueing work stopped.
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Reads the monotonic clock with clock_gettime(): it must never
+   go back, must keep nanoseconds in range, and must advance in
+   steps finer than a timer tick.  An unknown clock is an
+   error. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Nanoseconds in one 100 Hz timer tick. */
+#define TICK_NS 10000000
+
+static int64_t
+to_ns (const struct timespec *ts) 
+{
+  return ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+void
+test_main (void) 
+{
+  struct timespec prev, now;
+  int64_t step = -1;
+  int i;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &prev) == 0, "clock_gettime");
+  for (i = 0; i < 1000; i++)
+    {
+      if (clock_gettime (CLOCK_MONOTONIC, &now) != 0)
+        fail ("clock_gettime failed");
+      if (now.tv_nsec < 0 || now.tv_nsec >= 1000000000)
+        fail ("tv_nsec out of range: %ld", now.tv_nsec);
+      if (to_ns (&now) < to_ns (&prev))
+        fail ("clock went backward");
+      if (to_ns (&now) > to_ns (&prev)
+          && (step < 0 || to_ns (&now) - to_ns (&prev) < step))
+        step = to_ns (&now) - to_ns (&prev);
+      prev = now;
+    }
+  if (step < 0)
+    fail ("clock did not advance");
+  if (step >= TICK_NS)
+    fail ("clock only advances by whole ticks");
+  msg ("clock advances by less than a tick");
+
+  CHECK (clock_gettime (-1, &now) == -1, "clock_gettime with a bad clock");
+}
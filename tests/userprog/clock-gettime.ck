@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-gettime) begin
+(clock-gettime) clock_gettime
+(clock-gettime) clock advances by less than a tick
+(clock-gettime) clock_gettime with a bad clock
+(clock-gettime) end
+clock-gettime: exit(0)
+EOF
+pass;
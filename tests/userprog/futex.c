@@ -0,0 +1,33 @@
+/* Exercises futex_wait() and futex_wake() within one process,
+   where no other thread can wake us up, and checks that the
+   user-level mutex works when uncontended. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct mutex m = MUTEX_INITIALIZER;
+  struct condvar cv = CONDVAR_INITIALIZER;
+  int word = 5;
+
+  CHECK (futex_wait (&word, 6, -1) == -1,
+         "futex_wait on a changed value returns at once");
+  CHECK (futex_wait (&word, 5, 5) == 1,
+         "futex_wait with a timeout times out");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake with no waiters");
+
+  mutex_lock (&m);
+  CHECK (m.state == 1, "uncontended lock");
+  CHECK (!mutex_trylock (&m), "trylock of a held mutex fails");
+  CHECK (!condvar_timedwait (&cv, &m, 5), "condvar wait times out");
+  CHECK (m.state != 0, "mutex held again after the wait");
+  condvar_signal (&cv, &m);
+  mutex_unlock (&m);
+  CHECK (m.state == 0, "unlock");
+  CHECK (mutex_trylock (&m), "trylock of a free mutex succeeds");
+  mutex_unlock (&m);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex) begin
+(futex) futex_wait on a changed value returns at once
+(futex) futex_wait with a timeout times out
+(futex) futex_wake with no waiters
+(futex) uncontended lock
+(futex) trylock of a held mutex fails
+(futex) condvar wait times out
+(futex) mutex held again after the wait
+(futex) unlock
+(futex) trylock of a free mutex succeeds
+(futex) end
+futex: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Spins in user mode until getrusage() reports that user ticks
+   have been charged to this process, and sanity-checks the other
+   counters. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+
+  CHECK (getrusage (&before) == 0, "getrusage");
+  do
+    if (getrusage (&after) != 0)
+      fail ("getrusage failed while spinning");
+  while (after.user_ticks == before.user_ticks);
+  msg ("user ticks advanced");
+
+  if (after.kernel_ticks < before.kernel_ticks
+      || after.ready_ticks < before.ready_ticks
+      || after.lock_wait_ticks < before.lock_wait_ticks
+      || after.vol_switches < before.vol_switches
+      || after.invol_switches < before.invol_switches)
+    fail ("counter went backward");
+}
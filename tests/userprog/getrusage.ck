@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) getrusage
+(getrusage) user ticks advanced
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
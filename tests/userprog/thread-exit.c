@@ -0,0 +1,55 @@
+/* Checks that exit() in any thread ends the whole process: one
+   thread leaves alone with thread_quit(), then another calls
+   exit() while one sibling spins in user mode, one sleeps on a
+   lock and the main thread waits to join the spinner. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct mutex held_lock = MUTEX_INITIALIZER;
+static volatile bool stop;
+
+static int
+quitter (void *aux UNUSED) 
+{
+  thread_quit (5);
+}
+
+static int
+spinner (void *aux UNUSED) 
+{
+  while (!stop)
+    continue;
+  return 0;
+}
+
+static int
+sleeper (void *aux UNUSED) 
+{
+  mutex_lock (&held_lock);
+  fail ("sleeper got the lock");
+}
+
+static int
+exiter (void *aux UNUSED) 
+{
+  exit (57);
+}
+
+void
+test_main (void) 
+{
+  tid_t tid;
+
+  CHECK ((tid = thread_spawn (quitter, NULL)) != TID_ERROR, "spawn quitter");
+  CHECK (thread_join (tid) == 5, "join quitter");
+
+  mutex_lock (&held_lock);
+  CHECK (thread_spawn (sleeper, NULL) != TID_ERROR, "spawn sleeper");
+  CHECK ((tid = thread_spawn (spinner, NULL)) != TID_ERROR, "spawn spinner");
+  CHECK (thread_spawn (exiter, NULL) != TID_ERROR, "spawn exiter");
+  thread_join (tid);
+  fail ("joined spinner");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit) begin
+(thread-exit) spawn quitter
+(thread-exit) join quitter
+(thread-exit) spawn sleeper
+(thread-exit) spawn spinner
+(thread-exit) spawn exiter
+thread-exit: exit(57)
+EOF
+pass;
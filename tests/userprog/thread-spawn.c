@@ -0,0 +1,47 @@
+/* Spawns threads that share the process's memory and a lock,
+   joins them, and checks that each one's updates and return
+   value came through. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITER_CNT 1000
+
+static struct mutex counter_lock = MUTEX_INITIALIZER;
+static int counter;
+
+static int
+worker (void *aux) 
+{
+  int id = (int) (intptr_t) aux;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++) 
+    {
+      mutex_lock (&counter_lock);
+      counter++;
+      mutex_unlock (&counter_lock);
+    }
+  return id + 100;
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      tids[i] = thread_spawn (worker, (void *) (intptr_t) i);
+      CHECK (tids[i] != TID_ERROR, "spawn thread %d", i);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == i + 100, "join thread %d", i);
+  CHECK (thread_join (tids[0]) == -1, "join thread 0 again");
+  CHECK (wait (tids[1]) == -1, "wait for a thread");
+  CHECK (counter == THREAD_CNT * ITER_CNT, "counter is %d", counter);
+}
@@ -16,11 +16,14 @@
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
+#include "threads/lockstat.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -85,6 +88,7 @@ main (void) {
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	kmem_init ();
 	paging_init (mem_end);
 
 #ifdef USERPROG
@@ -105,6 +109,8 @@ main (void) {
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
+	workqueue_init ();
+	palloc_zero_init ();
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -221,6 +227,18 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-stride"))
+			thread_stride = true;
+		else if (!strcmp (name, "-rusage"))
+			thread_report_usage = true;
+		else if (!strcmp (name, "-trace"))
+			thread_trace_enabled = true;
+		else if (!strcmp (name, "-lockstat"))
+			lockstat_enabled = true;
+		else if (!strcmp (name, "-tcache"))
+			thread_cache_max = atoi (value);
+		else if (!strcmp (name, "-nohz"))
+			timer_nohz = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -231,6 +249,9 @@ parse_options (char **argv) {
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_stride)
+		PANIC ("-mlfqs and -stride cannot be used together");
+
 	return argv;
 }
 
@@ -326,6 +347,12 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -stride            Use stride (proportional-share) scheduler.\n"
+			"  -nohz              Stop the timer tick while idle.\n"
+			"  -rusage            Print each process's resource usage at exit.\n"
+			"  -trace             Trace scheduler events and dump them at shutdown.\n"
+			"  -lockstat          Print lock contention statistics at shutdown.\n"
+			"  -tcache=N          Keep up to N dead threads' pages for reuse.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -354,6 +381,11 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	malloc_print_stats ();
+	kmem_print_stats ();
+	lockstat_print ();
+	thread_trace_dump ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
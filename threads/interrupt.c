@@ -13,6 +13,7 @@
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -116,10 +117,12 @@ static const char *intr_names[INTR_CNT];
    interrupt returns. */
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
+static bool from_user;          /* Did the external interrupt hit user code? */
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
+static uint8_t pic_read_irr (int irq);
 
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
@@ -245,6 +248,14 @@ intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
+/* Returns true if external interrupt VEC_NO has been raised but
+   not yet delivered, as when it arrives with interrupts off. */
+bool
+intr_ext_pending (uint8_t vec_no) {
+	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+	return (pic_read_irr (vec_no) & (1 << (vec_no % 8))) != 0;
+}
+
 /* Registers internal interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The interrupt handler
    will be invoked with interrupt status LEVEL.
@@ -273,6 +284,14 @@ intr_context (void) {
 	return in_external_intr;
 }
 
+/* Returns true if the external interrupt being processed
+   interrupted code running in user mode. */
+bool
+intr_user_context (void) {
+	ASSERT (intr_context ());
+	return from_user;
+}
+
 /* During processing of an external interrupt, directs the
    interrupt handler to yield to a new process just before
    returning from the interrupt.  May not be called at any other
@@ -336,6 +355,19 @@ pic_end_of_interrupt (int irq) {
 	if (irq >= 0x28)
 		outb (0xa0, 0x20);
 }
+
+/* Returns the interrupt request register of the PIC that handles
+   the given IRQ, in which a bit is set for each of its lines
+   that has raised an interrupt that is not yet being serviced. */
+static uint8_t
+pic_read_irr (int irq) {
+	int port = irq >= 0x28 ? 0xa0 : 0x20;
+
+	ASSERT (irq >= 0x20 && irq < 0x30);
+
+	outb (port, 0x0a);   /* OCW3: read IRR on next read. */
+	return inb (port);
+}
 /* Interrupt handlers. */
 
 /* Handler for all interrupts, faults, and exceptions.  This
@@ -358,6 +390,11 @@ intr_handler (struct intr_frame *frame) {
 
 		in_external_intr = true;
 		yield_on_return = false;
+		from_user = (frame->cs & 3) == 3;
+
+		/* Any device interrupt ends a tickless idle period. */
+		if (frame->vec_no != 0x20)
+			timer_nohz_exit ();
 	}
 
 	/* Invoke the interrupt's handler. */
@@ -385,6 +422,16 @@ intr_handler (struct intr_frame *frame) {
 
 		if (yield_on_return)
 			thread_yield ();
+
+#ifdef USERPROG
+		/* A thread that was running user code when another thread
+		   of its process called exit() leaves here. */
+		if ((frame->cs & 3) == 3 && process_exiting ()) {
+			thread_current ()->exit_status = -1;
+			intr_enable ();
+			thread_exit ();
+		}
+#endif
 	}
 }
 
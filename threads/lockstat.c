@@ -0,0 +1,152 @@
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* If true, locks keep their statistics up to date.  Controlled
+   by kernel command-line option "-lockstat". */
+bool lockstat_enabled;
+
+/* Named locks, most recently named first. */
+static struct lockstat *named_locks;
+
+static void note_waiter (struct lockstat *, int64_t waited);
+
+/* Clears ST.  If NAME is non-null, ST is given that name and
+   registered for lockstat_print(). */
+void
+lockstat_init (struct lockstat *st, const char *name) {
+	enum intr_level old_level;
+
+	ASSERT (st != NULL);
+
+	memset (st, 0, sizeof *st);
+	if (name == NULL)
+		return;
+
+	strlcpy (st->name, name, sizeof st->name);
+	old_level = intr_disable ();
+	st->next = named_locks;
+	named_locks = st;
+	intr_set_level (old_level);
+}
+
+/* Records an acquisition of ST's lock by the current thread,
+   which waited WAITED nanoseconds for it, or -1 if it did not
+   have to wait.  Interrupts must be off. */
+void
+lockstat_acquired (struct lockstat *st, int64_t waited) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!lockstat_enabled)
+		return;
+
+	st->acquired++;
+	if (waited < 0)
+		return;
+
+	st->contended++;
+	st->wait_ns += waited;
+	if (waited > st->max_wait_ns)
+		st->max_wait_ns = waited;
+	note_waiter (st, waited);
+}
+
+/* Records that ST's lock went from free to held.  Interrupts must
+   be off. */
+void
+lockstat_hold (struct lockstat *st) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (lockstat_enabled)
+		st->held_since = timer_ns ();
+}
+
+/* Records that ST's lock became free.  Interrupts must be off. */
+void
+lockstat_unhold (struct lockstat *st) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (lockstat_enabled)
+		st->hold_ns += timer_ns () - st->held_since;
+}
+
+/* Charges a wait of WAITED nanoseconds to the current thread in ST's
+   table of waiters, replacing the entry that waited least if the
+   current thread is not in the table yet. */
+static void
+note_waiter (struct lockstat *st, int64_t waited) {
+	struct thread *cur = thread_current ();
+	struct lockstat_waiter *w = &st->top[0];
+	int i;
+
+	for (i = 0; i < LOCKSTAT_TOP; i++) {
+		if (st->top[i].tid == cur->tid) {
+			w = &st->top[i];
+			break;
+		}
+		if (st->top[i].wait_ns < w->wait_ns)
+			w = &st->top[i];
+	}
+
+	if (w->tid != cur->tid) {
+		w->tid = cur->tid;
+		strlcpy (w->name, cur->name, sizeof w->name);
+		w->waits = w->wait_ns = 0;
+	}
+	w->waits++;
+	w->wait_ns += waited;
+}
+
+/* Returns true if A was more contended than B. */
+static bool
+more_contended (const struct lockstat *a, const struct lockstat *b) {
+	if (a->contended != b->contended)
+		return a->contended > b->contended;
+	return a->wait_ns > b->wait_ns;
+}
+
+/* Prints the statistics of every named lock that was used, most
+   contended first, if the kernel runs with -lockstat. */
+void
+lockstat_print (void) {
+	struct lockstat *sorted = NULL;
+	struct lockstat *st, *next, **p;
+	enum intr_level old_level;
+	int i;
+
+	if (!lockstat_enabled)
+		return;
+
+	/* Insertion sort the named locks into SORTED. */
+	old_level = intr_disable ();
+	for (st = named_locks; st != NULL; st = next) {
+		next = st->next;
+		for (p = &sorted; *p != NULL && !more_contended (st, *p);
+				p = &(*p)->next)
+			continue;
+		st->next = *p;
+		*p = st;
+	}
+	named_locks = sorted;
+	intr_set_level (old_level);
+
+	printf ("Lock statistics, most contended first, times in us:\n");
+	printf ("  %-16s %10s %10s %10s %8s %10s\n", "lock", "acquired",
+			"contended", "wait", "max wait", "held");
+	for (st = sorted; st != NULL; st = st->next) {
+		if (st->acquired == 0)
+			continue;
+		printf ("  %-16s %10lld %10lld %10lld %8lld %10lld\n", st->name,
+				st->acquired, st->contended, st->wait_ns / 1000,
+				st->max_wait_ns / 1000, st->hold_ns / 1000);
+		for (i = 0; i < LOCKSTAT_TOP; i++)
+			if (st->top[i].tid != 0)
+				printf ("    waiter %s (tid %d): %lld waits, %lld us\n",
+						st->top[i].name, st->top[i].tid,
+						st->top[i].waits, st->top[i].wait_ns / 1000);
+	}
+}
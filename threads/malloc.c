@@ -6,39 +6,74 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/palloc.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages
+   blocks of that size.  The classes step up by factors of 3/2 and
+   4/3 in turn (16, 32, 48, 64, 96, 128, 192, ...) and then by
+   512 bytes, so that past 32 bytes no block is more than half
+   again as big as the request.  The descriptor keeps a list of
+   free blocks.  If the free list is nonempty, one of its blocks
+   is used to satisfy the request.
+
+   Otherwise, a new "arena" is obtained from the page allocator
+   (if none is available, malloc() returns a null pointer).  An
+   arena is a single page for the small classes, up to 1.5 kB,
+   but MEDIUM_PAGES pages for the medium classes above that,
+   which would otherwise fit only one block to a page.  The new
+   arena is divided into blocks, all of which are added to the
+   descriptor's free list.  Then we return one of the new blocks.
+   The blocks of a medium arena may straddle page boundaries, so
+   each page of every arena is registered with palloc_set_owner(),
+   which is how a block finds its arena.
 
    When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
-
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
+   If the arena that the block was in now has no in-use blocks,
+   it goes on the descriptor's list of empty arenas, but is not
+   given back to the page allocator yet, since the next malloc()
+   would likely want it again.  Only once more than EMPTY_HIGH
+   arenas are empty do we remove the blocks of the oldest ones
+   from the free list and give them back, leaving EMPTY_LOW.
+
+   We can't handle blocks bigger than the largest class using
+   this scheme.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Block sizes of the size classes. */
+static const size_t class_sizes[] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536,
+	2048, 2560, 3072,
+};
+
+/* Classes bigger than this use multi-page arenas. */
+#define SMALL_MAX 1536
+
+/* Pages in a medium arena. */
+#define MEDIUM_PAGES 4
+
+/* Empty arenas that a descriptor keeps: more than EMPTY_HIGH
+   triggers giving them back down to EMPTY_LOW. */
+#define EMPTY_HIGH 2
+#define EMPTY_LOW 1
+
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
+	size_t arena_pages;         /* Number of pages in an arena. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
+	struct list empty_arenas;   /* Arenas with no blocks in use, oldest first. */
+	size_t empty_cnt;           /* Number of arenas in EMPTY_ARENAS. */
+	size_t arena_cnt;           /* Number of arenas. */
+	size_t in_use;              /* Number of blocks in use. */
+	long long alloc_cnt;        /* Number of allocations, ever. */
+	long long req_bytes;        /* Bytes requested by them. */
 	struct lock lock;           /* Lock. */
 };
 
@@ -50,6 +85,7 @@ struct arena {
 	unsigned magic;             /* Always set to ARENA_MAGIC. */
 	struct desc *desc;          /* Owning descriptor, null for big block. */
 	size_t free_cnt;            /* Free blocks; pages in big block. */
+	struct list_elem empty_elem; /* Element in desc's EMPTY_ARENAS. */
 };
 
 /* Free block. */
@@ -58,25 +94,44 @@ struct block {
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[sizeof class_sizes / sizeof *class_sizes];
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics for big blocks. */
+static struct spinlock big_lock;
+static long long big_cnt;       /* Number of allocations, ever. */
+static long long big_req_bytes; /* Bytes requested by them. */
+static long long big_bytes;     /* Bytes allocated for them. */
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void release_arena (struct desc *, struct arena *);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t i;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	for (i = 0; i < sizeof class_sizes / sizeof *class_sizes; i++) {
 		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+		char name[16];
+
+		d->block_size = class_sizes[i];
+		d->arena_pages = d->block_size <= SMALL_MAX ? 1 : MEDIUM_PAGES;
+		d->blocks_per_arena = (PGSIZE * d->arena_pages
+				- sizeof (struct arena)) / d->block_size;
+		ASSERT (d->blocks_per_arena > 1);
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		list_init (&d->empty_arenas);
+		d->empty_cnt = 0;
+		d->arena_cnt = 0;
+		d->in_use = 0;
+		d->alloc_cnt = 0;
+		d->req_bytes = 0;
+		snprintf (name, sizeof name, "malloc %zu", d->block_size);
+		lock_init_named (&d->lock, name);
 	}
+	spin_init (&big_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -100,6 +155,8 @@ malloc (size_t size) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
+		enum intr_level old_level;
+
 		a = palloc_get_multiple (0, page_cnt);
 		if (a == NULL)
 			return NULL;
@@ -109,6 +166,13 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+		palloc_set_owner (a, a);
+
+		old_level = spin_lock_irqsave (&big_lock);
+		big_cnt++;
+		big_req_bytes += size;
+		big_bytes += PGSIZE * page_cnt;
+		spin_unlock_irqrestore (&big_lock, old_level);
 		return a + 1;
 	}
 
@@ -118,27 +182,39 @@ malloc (size_t size) {
 	if (list_empty (&d->free_list)) {
 		size_t i;
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
+		/* Allocate its pages. */
+		a = palloc_get_multiple (0, d->arena_pages);
 		if (a == NULL) {
 			lock_release (&d->lock);
 			return NULL;
 		}
 
-		/* Initialize arena and add its blocks to the free list. */
+		/* Initialize arena and add its blocks to the free list.
+		   It starts out empty. */
 		a->magic = ARENA_MAGIC;
 		a->desc = d;
 		a->free_cnt = d->blocks_per_arena;
+		for (i = 0; i < d->arena_pages; i++)
+			palloc_set_owner ((uint8_t *) a + PGSIZE * i, a);
 		for (i = 0; i < d->blocks_per_arena; i++) {
 			struct block *b = arena_to_block (a, i);
 			list_push_back (&d->free_list, &b->free_elem);
 		}
+		list_push_back (&d->empty_arenas, &a->empty_elem);
+		d->empty_cnt++;
+		d->arena_cnt++;
 	}
 
 	/* Get a block from free list and return it. */
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
-	a->free_cnt--;
+	if (a->free_cnt-- == d->blocks_per_arena) {
+		list_remove (&a->empty_elem);
+		d->empty_cnt--;
+	}
+	d->in_use++;
+	d->alloc_cnt++;
+	d->req_bytes += size;
 	lock_release (&d->lock);
 	return b;
 }
@@ -217,17 +293,17 @@ free (void *p) {
 
 			/* Add block to free list. */
 			list_push_front (&d->free_list, &b->free_elem);
+			d->in_use--;
 
-			/* If the arena is now entirely unused, free it. */
+			/* If the arena is now entirely unused, set it aside, and
+			   if too many are, free the oldest. */
 			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
 				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+				list_push_back (&d->empty_arenas, &a->empty_elem);
+				if (++d->empty_cnt > EMPTY_HIGH)
+					while (d->empty_cnt > EMPTY_LOW)
+						release_arena (d, list_entry (list_front (&d->empty_arenas),
+									struct arena, empty_elem));
 			}
 
 			lock_release (&d->lock);
@@ -239,10 +315,34 @@ free (void *p) {
 	}
 }
 
+/* Prints, for each size class and for big blocks, how many
+   allocations there have been and how much of the memory they
+   were given went unrequested. */
+void
+malloc_print_stats (void) {
+	struct desc *d;
+
+	for (d = descs; d < descs + desc_cnt; d++) {
+		long long bytes = d->alloc_cnt * (long long) d->block_size;
+
+		if (d->alloc_cnt == 0)
+			continue;
+		printf ("malloc %4zu: %'lld allocations, %lld%% internal "
+				"fragmentation, %zu in use in %zu arenas (%zu empty)\n",
+				d->block_size, d->alloc_cnt,
+				(bytes - d->req_bytes) * 100 / bytes,
+				d->in_use, d->arena_cnt, d->empty_cnt);
+	}
+	if (big_cnt > 0)
+		printf ("malloc  big: %'lld allocations, %lld%% internal "
+				"fragmentation\n",
+				big_cnt, (big_bytes - big_req_bytes) * 100 / big_bytes);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
-	struct arena *a = pg_round_down (b);
+	struct arena *a = palloc_get_owner (b);
 
 	/* Check that the arena is valid. */
 	ASSERT (a != NULL);
@@ -250,12 +350,30 @@ block_to_arena (struct block *b) {
 
 	/* Check that the block is properly aligned for the arena. */
 	ASSERT (a->desc == NULL
-			|| (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-	ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+			|| ((uint8_t *) b - (uint8_t *) (a + 1)) % a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || (void *) b == a + 1);
 
 	return a;
 }
 
+/* Removes the blocks of empty arena A from descriptor D's free
+   list and gives A back to the page allocator.  D's lock must be
+   held. */
+static void
+release_arena (struct desc *d, struct arena *a) {
+	size_t i;
+
+	ASSERT (a->free_cnt == d->blocks_per_arena);
+	for (i = 0; i < d->blocks_per_arena; i++) {
+		struct block *b = arena_to_block (a, i);
+		list_remove (&b->free_elem);
+	}
+	list_remove (&a->empty_elem);
+	d->empty_cnt--;
+	d->arena_cnt--;
+	palloc_free_multiple (a, d->arena_pages);
+}
+
 /* Returns the (IDX - 1)'th block within arena A. */
 static struct block *
 arena_to_block (struct arena *a, size_t idx) {
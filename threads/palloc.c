@@ -2,14 +2,19 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,15 +29,124 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free memory is kept as
+   blocks of 2**ORDER pages, for ORDER from 0 to MAX_ORDER, each
+   aligned to its size counting from the start of the pool, with
+   one free list per order.  A request is rounded up to a power of
+   two, served from the smallest free block that fits, splitting
+   larger blocks as needed, and the pages past the request are
+   freed again at once.  A freed block merges with its "buddy",
+   the other half of the block it was split from, whenever that is
+   free too, so allocation and freeing take O(MAX_ORDER) steps no
+   matter how full or fragmented the pool is.
+
+   The bookkeeping lives beside the pool's bitmap, never in the
+   free pages, which need not be mapped yet when the pools are
+   populated at boot.  A free block is linked into its free list
+   through the LINKS entry for its first page, and ORDER_MAP
+   records its order at the same index.  USED_MAP still has a bit
+   per page, for checking frees.  The LINKS entry of a page in use
+   holds instead whatever its user passed to palloc_set_owner().
+
+   Single pages, by far the most common request, mostly bypass
+   the buddy allocator and its lock.  Each CPU keeps two
+   "magazines" of free pages per pool, after Bonwick and Adams'
+   Vmem paper, which it uses with interrupts off and no lock:
+   frees push onto the loaded magazine and gets pop from it, and
+   when it is full (on free) or empty (on get) the CPU swaps it
+   with its previous magazine.  Only when both are unusable does
+   it go to the pool's depot, which trades it a full magazine for
+   an empty one or the other way around under a lock of its own.
+   Only when the depot has none to trade does the CPU take the
+   pool lock, to fill a magazine from the buddy allocator or to
+   empty one back into it, MAG_SIZE pages at a time.  Pages in
+   magazines and the depot are still marked used in USED_MAP.
+
+   Each pool owns a fixed set of magazines: two per CPU and
+   DEPOT_MAX in the depot.  A CPU always holds exactly two, so the
+   depot holds at most DEPOT_MAX full magazines, which bounds the
+   free pages that the buddy allocator cannot see.
+
+   Finally, each pool keeps up to ZERO_TARGET free pages that have
+   already been zeroed, so that PAL_ZERO requests, such as for
+   every user frame, need not memset() a page on the spot.  The
+   idle thread zeroes pages whenever nothing else is ready to run
+   (see palloc_zero_page()), and the "kzerod" thread, which runs
+   at the lowest priority, is woken up to refill a pool that has
+   fallen below ZERO_LOW.  A single-page request that finds no
+   other free page takes a zeroed one anyway, and a multi-page
+   request that fails gives the zeroed pages back to the buddy
+   allocator and tries again. */
+
+/* Largest block order: blocks of up to 1024 pages (4 MB). */
+#define MAX_ORDER 10
+
+/* ORDER_MAP entry for a page that does not start a free block. */
+#define NOT_FREE 0xff
+
+/* Pages per magazine. */
+#define MAG_SIZE 16
+
+/* Magazines in each pool's depot. */
+#define DEPOT_MAX 4
+
+/* Zeroed pages that each pool keeps, and the number below which
+   kzerod is woken up to zero more. */
+#define ZERO_TARGET 64
+#define ZERO_LOW (ZERO_TARGET / 4)
+
+/* A magazine: a stack of free single pages. */
+struct magazine {
+	struct list_elem elem;          /* Element in a depot list. */
+	int cnt;                        /* Number of pages in PAGES. */
+	void *pages[MAG_SIZE];          /* Free pages, top at PAGES[CNT - 1]. */
+};
+
+/* One CPU's magazines for one pool.  Used only by that CPU, with
+   interrupts off. */
+struct mag_cpu {
+	struct magazine *loaded;        /* Magazine to get and free from. */
+	struct magazine *previous;      /* Full or empty spare. */
+	long long get_cnt;              /* Single-page gets. */
+	long long free_cnt;             /* Single-page frees. */
+};
+
+/* Per-page bookkeeping. */
+union page_link {
+	struct list_elem free_elem;     /* Free list element, for a free block. */
+	void *owner;                    /* Owner, for a page in use. */
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
+	struct spinlock lock;           /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
+	uint8_t *order_map;             /* Order of each free block. */
+	union page_link *links;         /* Bookkeeping for each page. */
+	struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
 	uint8_t *base;                  /* Base of pool. */
+	long long lock_cnt;             /* Acquisitions of LOCK. */
+
+	struct spinlock depot_lock;     /* Protects the depot lists. */
+	struct list depot_full;         /* Full magazines. */
+	struct list depot_empty;        /* Empty magazines. */
+	struct mag_cpu cpu_mags[CPU_MAX]; /* Each CPU's magazines. */
+	struct magazine mags[CPU_MAX * 2 + DEPOT_MAX]; /* All magazines. */
+
+	struct spinlock zero_lock;      /* Protects the members below. */
+	struct list zeroed;             /* Zeroed pages, linked through LINKS. */
+	size_t zero_cnt;                /* Number of pages in ZEROED. */
+	long long zero_hits;            /* PAL_ZERO pages found in ZEROED. */
+	long long zero_misses;          /* PAL_ZERO pages zeroed on request. */
+	long long zero_bg;              /* Pages zeroed in the background. */
 };
 
+/* Upped to wake up kzerod. */
+static struct semaphore zero_wanted;
+static bool kzerod_started;
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
@@ -42,6 +156,21 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static int order_of (size_t page_cnt);
+static size_t buddy_alloc (struct pool *, int order);
+static void buddy_free (struct pool *, size_t page_idx, int order);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static enum intr_level pool_lock (struct pool *);
+static void *mag_get (struct pool *);
+static void mag_put (struct pool *, void *page);
+static bool depot_exchange (struct pool *, struct magazine **, bool want_full);
+static void mag_fill (struct pool *, struct magazine *);
+static void mag_empty (struct pool *, struct magazine *);
+static bool depot_reclaim (struct pool *);
+static void *zeroed_get (struct pool *);
+static bool zeroed_reclaim (struct pool *);
+static bool zero_one (struct pool *);
+static void kzerod (void *aux);
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +353,13 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				free_range (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				free_range (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -258,24 +389,64 @@ palloc_init (void) {
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.  At most 2**MAX_ORDER
+   pages can be obtained at once. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	enum intr_level old_level;
+	size_t page_idx = BITMAP_ERROR;
+	int order = order_of (page_cnt);
+	bool zeroed = false;
 	void *pages;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
+	if (page_cnt == 1) {
 		pages = NULL;
+		if (flags & PAL_ZERO) {
+			pages = zeroed_get (pool);
+			zeroed = pages != NULL;
+		}
+		if (pages == NULL)
+			pages = mag_get (pool);
+		if (pages == NULL)
+			pages = zeroed_get (pool);
+	} else {
+		while (order <= MAX_ORDER) {
+			old_level = pool_lock (pool);
+			page_idx = buddy_alloc (pool, order);
+			if (page_idx != BITMAP_ERROR) {
+				/* Give back the pages past PAGE_CNT. */
+				free_range (pool, page_idx + page_cnt,
+						((size_t) 1 << order) - page_cnt);
+				ASSERT (!bitmap_any (pool->used_map, page_idx, page_cnt));
+				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+			}
+			spin_unlock_irqrestore (&pool->lock, old_level);
+
+			/* The pages we need may be sitting in the depot or among
+			   the zeroed pages. */
+			if (page_idx != BITMAP_ERROR
+					|| !(depot_reclaim (pool) | zeroed_reclaim (pool)))
+				break;
+		}
+
+		if (page_idx != BITMAP_ERROR)
+			pages = pool->base + PGSIZE * page_idx;
+		else
+			pages = NULL;
+	}
 
 	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+		if (flags & PAL_ZERO) {
+			if (!zeroed)
+				memset (pages, 0, PGSIZE * page_cnt);
+			old_level = spin_lock_irqsave (&pool->zero_lock);
+			if (zeroed)
+				pool->zero_hits++;
+			else
+				pool->zero_misses += page_cnt;
+			spin_unlock_irqrestore (&pool->zero_lock, old_level);
+		}
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -296,10 +467,13 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
-/* Frees the PAGE_CNT pages starting at PAGES. */
+/* Frees the PAGE_CNT pages starting at PAGES.  They need not be
+   exactly the pages of one palloc_get_multiple() call.  May be
+   called with interrupts off. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
+	enum intr_level old_level;
 	size_t page_idx;
 
 	ASSERT (pg_ofs (pages) == 0);
@@ -318,8 +492,16 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	if (page_cnt == 1) {
+		mag_put (pool, pages);
+		return;
+	}
+
+	old_level = pool_lock (pool);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	free_range (pool, page_idx, page_cnt);
+	spin_unlock_irqrestore (&pool->lock, old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +510,104 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Records OWNER for the page at PAGE, which must be in use, to be
+   returned by palloc_get_owner().  This lets an allocator built
+   on this one find its bookkeeping from any address in its
+   pages, even pages that do not start with a header. */
+void
+palloc_set_owner (void *page, void *owner) {
+	struct pool *pool;
+
+	ASSERT (pg_ofs (page) == 0);
+	if (page_from_pool (&kernel_pool, page))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, page))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	ASSERT (bitmap_test (pool->used_map, pg_no (page) - pg_no (pool->base)));
+	pool->links[pg_no (page) - pg_no (pool->base)].owner = owner;
+}
+
+/* Returns what was last passed to palloc_set_owner() for the page
+   that contains ADDR.  The page must be in use. */
+void *
+palloc_get_owner (const void *addr) {
+	struct pool *pool;
+	void *page = pg_round_down (addr);
+
+	if (page_from_pool (&kernel_pool, page))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, page))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	return pool->links[pg_no (page) - pg_no (pool->base)].owner;
+}
+
+/* Starts the kzerod thread.  The thread system must already be
+   running. */
+void
+palloc_zero_init (void) {
+	sema_init (&zero_wanted, 0);
+	if (thread_create ("kzerod", PRI_MIN, kzerod, NULL) == TID_ERROR)
+		PANIC ("cannot start kzerod");
+	kzerod_started = true;
+}
+
+/* Zeroes one free page for a pool that has fewer than
+   ZERO_TARGET zeroed pages.  Returns false if there was nothing
+   to do.  Called by the idle thread, so it never sleeps. */
+bool
+palloc_zero_page (void) {
+	return zero_one (&user_pool) || zero_one (&kernel_pool);
+}
+
+/* Prints page allocator statistics.  Comparing the single-page
+   gets and frees with the pool lock acquisitions shows how much
+   locking the magazines save. */
+void
+palloc_print_stats (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	const char *names[] = { "Kernel", "User" };
+	size_t i;
+	int c;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *pool = pools[i];
+		long long get_cnt = 0, free_cnt = 0;
+
+		for (c = 0; c < CPU_MAX; c++) {
+			get_cnt += pool->cpu_mags[c].get_cnt;
+			free_cnt += pool->cpu_mags[c].free_cnt;
+		}
+		printf ("%s pool: %'lld page gets, %'lld page frees, "
+				"%'lld pool lock acquisitions\n",
+				names[i], get_cnt, free_cnt, pool->lock_cnt);
+		printf ("%s pool: %'lld of %'lld zeroed pages pre-zeroed, "
+				"%'lld zeroed in the background\n",
+				names[i], pool->zero_hits, pool->zero_hits + pool->zero_misses,
+				pool->zero_bg);
+	}
+}
+
+/* Stores in *HITS the number of PAL_ZERO pages that the pool
+   FLAGS selects has handed out already zeroed, and in *MISSES the
+   number it had to zero on the spot. */
+void
+palloc_zero_stats (enum palloc_flags flags, long long *hits,
+		long long *misses) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+
+	old_level = spin_lock_irqsave (&pool->zero_lock);
+	*hits = pool->zero_hits;
+	*misses = pool->zero_misses;
+	spin_unlock_irqrestore (&pool->zero_lock, old_level);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -336,15 +616,38 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t om_pages = DIV_ROUND_UP (pgcnt, PGSIZE) * PGSIZE;
+	size_t ln_pages = DIV_ROUND_UP (pgcnt * sizeof *p->links, PGSIZE) * PGSIZE;
+	int order, i;
 
-	lock_init(&p->lock);
+	spin_init (&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->order_map = *bm_base + bm_pages;
+	p->links = *bm_base + bm_pages + om_pages;
+	for (order = 0; order <= MAX_ORDER; order++)
+		list_init (&p->free_lists[order]);
 	p->base = (void *) start;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->order_map, NOT_FREE, pgcnt);
+
+	/* Give each CPU two empty magazines and the depot the rest. */
+	spin_init (&p->depot_lock);
+	list_init (&p->depot_full);
+	list_init (&p->depot_empty);
+	for (i = 0; i < CPU_MAX; i++) {
+		p->cpu_mags[i].loaded = &p->mags[2 * i];
+		p->cpu_mags[i].previous = &p->mags[2 * i + 1];
+	}
+	for (i = 2 * CPU_MAX; i < CPU_MAX * 2 + DEPOT_MAX; i++)
+		list_push_back (&p->depot_empty, &p->mags[i].elem);
 
-	*bm_base += bm_pages;
+	spin_init (&p->zero_lock);
+	list_init (&p->zeroed);
+	p->zero_cnt = 0;
+
+	*bm_base += bm_pages + om_pages + ln_pages;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -356,3 +659,317 @@ page_from_pool (const struct pool *pool, void *page) {
 	size_t end_page = start_page + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int
+order_of (size_t page_cnt) {
+	int order = 0;
+
+	while (((size_t) 1 << order) < page_cnt)
+		order++;
+	return order;
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX to POOL's
+   free lists. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order) {
+	pool->order_map[page_idx] = order;
+	list_push_front (&pool->free_lists[order],
+			&pool->links[page_idx].free_elem);
+}
+
+/* Takes a block of 2**ORDER pages out of POOL's free lists and
+   returns the index of its first page, or BITMAP_ERROR if no
+   block is big enough.  POOL's lock must be held. */
+static size_t
+buddy_alloc (struct pool *pool, int order) {
+	size_t page_idx;
+	int o;
+
+	for (o = order; o <= MAX_ORDER; o++)
+		if (!list_empty (&pool->free_lists[o]))
+			break;
+	if (o > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = list_entry (list_pop_front (&pool->free_lists[o]),
+			union page_link, free_elem) - pool->links;
+	pool->order_map[page_idx] = NOT_FREE;
+
+	/* Split it down to size, freeing the upper halves. */
+	while (o > order) {
+		o--;
+		push_block (pool, page_idx + ((size_t) 1 << o), o);
+	}
+	return page_idx;
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL, merging
+   it with its buddy for as long as that is free.  POOL's lock
+   must be held. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, int order) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+
+	while (order < MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy + ((size_t) 1 << order) > page_cnt
+				|| pool->order_map[buddy] != order)
+			break;
+		list_remove (&pool->links[buddy].free_elem);
+		pool->order_map[buddy] = NOT_FREE;
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+	push_block (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, as the largest
+   aligned blocks that cover them.  POOL's lock must be held. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < MAX_ORDER
+				&& (page_idx & (((size_t) 2 << order) - 1)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_free (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Acquires POOL's lock, counting the acquisition, and returns
+   the previous interrupt level. */
+static enum intr_level
+pool_lock (struct pool *pool) {
+	enum intr_level old_level = spin_lock_irqsave (&pool->lock);
+
+	pool->lock_cnt++;
+	return old_level;
+}
+
+/* Gets a single page from POOL through the running CPU's
+   magazines.  Returns a null pointer if POOL has no free page. */
+static void *
+mag_get (struct pool *pool) {
+	enum intr_level old_level = intr_disable ();
+	struct mag_cpu *mc = &pool->cpu_mags[this_cpu ()->id];
+	void *page = NULL;
+
+	mc->get_cnt++;
+	if (mc->loaded->cnt == 0) {
+		if (mc->previous->cnt > 0) {
+			struct magazine *m = mc->loaded;
+			mc->loaded = mc->previous;
+			mc->previous = m;
+		} else if (!depot_exchange (pool, &mc->loaded, true))
+			mag_fill (pool, mc->loaded);
+	}
+	if (mc->loaded->cnt > 0)
+		page = mc->loaded->pages[--mc->loaded->cnt];
+	intr_set_level (old_level);
+
+	return page;
+}
+
+/* Frees single page PAGE, from POOL, into the running CPU's
+   magazines. */
+static void
+mag_put (struct pool *pool, void *page) {
+	enum intr_level old_level = intr_disable ();
+	struct mag_cpu *mc = &pool->cpu_mags[this_cpu ()->id];
+#ifndef NDEBUG
+	int i;
+
+	/* Catch the likeliest double frees, which USED_MAP cannot. */
+	for (i = 0; i < mc->loaded->cnt; i++)
+		ASSERT (mc->loaded->pages[i] != page);
+	for (i = 0; i < mc->previous->cnt; i++)
+		ASSERT (mc->previous->pages[i] != page);
+#endif
+
+	mc->free_cnt++;
+	if (mc->loaded->cnt == MAG_SIZE) {
+		if (mc->previous->cnt < MAG_SIZE) {
+			struct magazine *m = mc->loaded;
+			mc->loaded = mc->previous;
+			mc->previous = m;
+		} else if (!depot_exchange (pool, &mc->loaded, false))
+			mag_empty (pool, mc->loaded);
+	}
+	mc->loaded->pages[mc->loaded->cnt++] = page;
+	intr_set_level (old_level);
+}
+
+/* Trades *MAG, which is empty if WANT_FULL is true and full
+   otherwise, for a full or an empty magazine, respectively, from
+   POOL's depot.  Returns false if the depot has none. */
+static bool
+depot_exchange (struct pool *pool, struct magazine **mag, bool want_full) {
+	struct list *from = want_full ? &pool->depot_full : &pool->depot_empty;
+	struct list *to = want_full ? &pool->depot_empty : &pool->depot_full;
+	bool ok = false;
+
+	spin_lock (&pool->depot_lock);
+	if (!list_empty (from)) {
+		list_push_front (to, &(*mag)->elem);
+		*mag = list_entry (list_pop_front (from), struct magazine, elem);
+		ok = true;
+	}
+	spin_unlock (&pool->depot_lock);
+
+	return ok;
+}
+
+/* Fills empty magazine MAG with as many as MAG_SIZE pages from
+   POOL's buddy allocator. */
+static void
+mag_fill (struct pool *pool, struct magazine *mag) {
+	enum intr_level old_level = pool_lock (pool);
+
+	while (mag->cnt < MAG_SIZE) {
+		size_t page_idx = buddy_alloc (pool, 0);
+
+		if (page_idx == BITMAP_ERROR)
+			break;
+		ASSERT (!bitmap_test (pool->used_map, page_idx));
+		bitmap_mark (pool->used_map, page_idx);
+		mag->pages[mag->cnt++] = pool->base + PGSIZE * page_idx;
+	}
+	spin_unlock_irqrestore (&pool->lock, old_level);
+}
+
+/* Returns all the pages in MAG to POOL's buddy allocator. */
+static void
+mag_empty (struct pool *pool, struct magazine *mag) {
+	enum intr_level old_level = pool_lock (pool);
+
+	while (mag->cnt > 0) {
+		size_t page_idx = pg_no (mag->pages[--mag->cnt]) - pg_no (pool->base);
+
+		ASSERT (bitmap_test (pool->used_map, page_idx));
+		bitmap_reset (pool->used_map, page_idx);
+		buddy_free (pool, page_idx, 0);
+	}
+	spin_unlock_irqrestore (&pool->lock, old_level);
+}
+
+/* Returns the pages in POOL's full depot magazines to the buddy
+   allocator, so that they can merge into larger blocks.  Returns
+   true if there were any. */
+static bool
+depot_reclaim (struct pool *pool) {
+	enum intr_level old_level = spin_lock_irqsave (&pool->depot_lock);
+	bool any = !list_empty (&pool->depot_full);
+
+	while (!list_empty (&pool->depot_full)) {
+		struct magazine *mag = list_entry (list_pop_front (&pool->depot_full),
+				struct magazine, elem);
+		mag_empty (pool, mag);
+		list_push_front (&pool->depot_empty, &mag->elem);
+	}
+	spin_unlock_irqrestore (&pool->depot_lock, old_level);
+
+	return any;
+}
+
+/* Takes a page from POOL's zeroed pages and returns it, or
+   returns a null pointer if there are none.  Wakes up kzerod if
+   that leaves too few. */
+static void *
+zeroed_get (struct pool *pool) {
+	enum intr_level old_level;
+	void *page = NULL;
+	bool wake;
+
+	old_level = spin_lock_irqsave (&pool->zero_lock);
+	if (!list_empty (&pool->zeroed)) {
+		union page_link *link = list_entry (list_pop_front (&pool->zeroed),
+				union page_link, free_elem);
+		page = pool->base + PGSIZE * (link - pool->links);
+		pool->zero_cnt--;
+	}
+	wake = page != NULL && pool->zero_cnt == ZERO_LOW - 1;
+	spin_unlock_irqrestore (&pool->zero_lock, old_level);
+
+	/* kzerod has the lowest priority, so this does not yield. */
+	if (wake && kzerod_started)
+		sema_up (&zero_wanted);
+	return page;
+}
+
+/* Returns all of POOL's zeroed pages to the buddy allocator.
+   Returns true if there were any. */
+static bool
+zeroed_reclaim (struct pool *pool) {
+	enum intr_level old_level = spin_lock_irqsave (&pool->zero_lock);
+	bool any = !list_empty (&pool->zeroed);
+
+	if (any) {
+		spin_lock (&pool->lock);
+		pool->lock_cnt++;
+		while (!list_empty (&pool->zeroed)) {
+			union page_link *link = list_entry (list_pop_front (&pool->zeroed),
+					union page_link, free_elem);
+			size_t page_idx = link - pool->links;
+
+			ASSERT (bitmap_test (pool->used_map, page_idx));
+			bitmap_reset (pool->used_map, page_idx);
+			buddy_free (pool, page_idx, 0);
+		}
+		pool->zero_cnt = 0;
+		spin_unlock (&pool->lock);
+	}
+	spin_unlock_irqrestore (&pool->zero_lock, old_level);
+
+	return any;
+}
+
+/* Zeroes a free page and adds it to POOL's zeroed pages, unless
+   POOL already has ZERO_TARGET of them or no free page.  Returns
+   true if it zeroed a page.  The zeroing itself is done with
+   interrupts on, since the page is ours alone until it is on
+   the list. */
+static bool
+zero_one (struct pool *pool) {
+	enum intr_level old_level;
+	size_t page_idx;
+
+	if (pool->zero_cnt >= ZERO_TARGET)
+		return false;
+
+	old_level = pool_lock (pool);
+	page_idx = buddy_alloc (pool, 0);
+	if (page_idx != BITMAP_ERROR) {
+		ASSERT (!bitmap_test (pool->used_map, page_idx));
+		bitmap_mark (pool->used_map, page_idx);
+	}
+	spin_unlock_irqrestore (&pool->lock, old_level);
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	memset (pool->base + PGSIZE * page_idx, 0, PGSIZE);
+
+	old_level = spin_lock_irqsave (&pool->zero_lock);
+	list_push_front (&pool->zeroed, &pool->links[page_idx].free_elem);
+	pool->zero_cnt++;
+	pool->zero_bg++;
+	spin_unlock_irqrestore (&pool->zero_lock, old_level);
+
+	return true;
+}
+
+/* Thread that zeroes pages when a pool runs low on them. */
+static void
+kzerod (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&zero_wanted);
+		while (palloc_zero_page ())
+			continue;
+	}
+}
@@ -0,0 +1,302 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/spinlock.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator, after Bonwick's "The Slab Allocator: An
+   Object-Caching Kernel Memory Allocator".
+
+   Each slab is one page from the kernel pool.  It begins with a
+   struct slab, followed by a stack of the indexes of its free
+   objects and then by the objects themselves, packed at the
+   cache's object size.  Keeping the free stack outside the
+   objects is what lets a freed object keep its constructed
+   state.
+
+   A cache keeps its slabs on three lists, by whether all, some
+   or none of their objects are in use.  Allocation prefers a
+   partly used slab, so that objects pack into as few slabs as
+   possible, then an empty one, and only then creates a new slab.
+   When a slab becomes empty it is kept for reuse if the cache has
+   fewer than EMPTY_MAX empty slabs, and otherwise its page goes
+   back to the page allocator. */
+
+/* Identifies a slab. */
+#define SLAB_MAGIC 0x51ab0bec
+
+/* Alignment of objects. */
+#define OBJ_ALIGN 8
+
+/* Empty slabs that a cache keeps instead of freeing. */
+#define EMPTY_MAX 1
+
+/* An object cache. */
+struct kmem_cache {
+	char name[16];              /* Name, for statistics. */
+	size_t obj_size;            /* Object size, rounded up to OBJ_ALIGN. */
+	size_t obj_ofs;             /* Offset of the first object in a slab. */
+	size_t objs_per_slab;       /* Objects in each slab. */
+	kmem_ctor *ctor;            /* Constructor, or a null pointer. */
+	struct list_elem elem;      /* Element in CACHES. */
+
+	struct spinlock lock;       /* Protects the members below. */
+	struct list partial;        /* Slabs with some objects in use. */
+	struct list full;           /* Slabs with all objects in use. */
+	struct list empty;          /* Slabs with no objects in use. */
+	size_t empty_cnt;           /* Number of slabs in EMPTY. */
+	size_t slab_cnt;            /* Number of slabs. */
+	size_t in_use;              /* Objects allocated and not freed. */
+	long long hit_cnt;          /* Allocations from an existing slab. */
+	long long miss_cnt;         /* Allocations that needed a new slab. */
+};
+
+/* Header at the start of each slab. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of the cache's lists. */
+	size_t free_cnt;            /* Number of entries in FREE_IDX. */
+	uint16_t free_idx[];        /* Indexes of free objects. */
+};
+
+/* All caches, for kmem_print_stats(). */
+static struct list caches;
+static struct spinlock caches_lock;
+
+static struct slab *slab_create (struct kmem_cache *);
+static void slab_destroy (struct slab *);
+static void destroy_list (struct list *);
+
+/* Initializes the slab allocator.  malloc() must already be
+   usable. */
+void
+kmem_init (void) {
+	list_init (&caches);
+	spin_init (&caches_lock);
+}
+
+/* Creates and returns a cache of objects SIZE bytes long, called
+   NAME in statistics.  If CTOR is nonnull, it is run on each
+   object when the slab that holds it is created.  Panics if SIZE
+   is too big to fit an object in a page, and returns a null
+   pointer if memory is not available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor *ctor) {
+	struct kmem_cache *c;
+	enum intr_level old_level;
+	size_t n;
+
+	ASSERT (size > 0);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		return NULL;
+
+	strlcpy (c->name, name, sizeof c->name);
+	c->obj_size = ROUND_UP (size, OBJ_ALIGN);
+	c->ctor = ctor;
+
+	/* Fit as many objects as we can, with their free stack. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	while (n > 0
+			&& ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), OBJ_ALIGN)
+			+ n * c->obj_size > PGSIZE)
+		n--;
+	if (n == 0)
+		PANIC ("kmem_cache_create: %zu-byte objects are too big", size);
+	c->objs_per_slab = n;
+	c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+			OBJ_ALIGN);
+
+	spin_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	c->slab_cnt = 0;
+	c->in_use = 0;
+	c->hit_cnt = 0;
+	c->miss_cnt = 0;
+
+	old_level = spin_lock_irqsave (&caches_lock);
+	list_push_back (&caches, &c->elem);
+	spin_unlock_irqrestore (&caches_lock, old_level);
+
+	return c;
+}
+
+/* Destroys cache C and gives its slabs back to the page
+   allocator.  Every object allocated from C must have been
+   freed. */
+void
+kmem_cache_destroy (struct kmem_cache *c) {
+	enum intr_level old_level;
+
+	if (c == NULL)
+		return;
+	ASSERT (c->in_use == 0);
+
+	old_level = spin_lock_irqsave (&caches_lock);
+	list_remove (&c->elem);
+	spin_unlock_irqrestore (&caches_lock, old_level);
+
+	destroy_list (&c->partial);
+	destroy_list (&c->full);
+	destroy_list (&c->empty);
+	free (c);
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available.  May be called with
+   interrupts off. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	enum intr_level old_level;
+	struct slab *s = NULL;
+	void *obj;
+
+	old_level = spin_lock_irqsave (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (!list_empty (&c->empty)) {
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		c->empty_cnt--;
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	if (s != NULL)
+		c->hit_cnt++;
+	else {
+		/* Build the new slab, which may run constructors, without
+		   holding the lock. */
+		spin_unlock_irqrestore (&c->lock, old_level);
+		s = slab_create (c);
+		if (s == NULL)
+			return NULL;
+		old_level = spin_lock_irqsave (&c->lock);
+		c->miss_cnt++;
+		c->slab_cnt++;
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	ASSERT (s->free_cnt > 0);
+	obj = (uint8_t *) s + c->obj_ofs + c->obj_size * s->free_idx[--s->free_cnt];
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->in_use++;
+	spin_unlock_irqrestore (&c->lock, old_level);
+
+	return obj;
+}
+
+/* Frees OBJ, which must have been allocated from cache C.  May be
+   called with interrupts off. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	enum intr_level old_level;
+	struct slab *s, *victim = NULL;
+	size_t ofs;
+
+	if (obj == NULL)
+		return;
+
+	s = pg_round_down (obj);
+	ofs = pg_ofs (obj);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT (ofs >= c->obj_ofs && (ofs - c->obj_ofs) % c->obj_size == 0);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it is meant to keep its constructed state. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	old_level = spin_lock_irqsave (&c->lock);
+	ASSERT (s->free_cnt < c->objs_per_slab);
+	list_remove (&s->elem);
+	s->free_idx[s->free_cnt++] = (ofs - c->obj_ofs) / c->obj_size;
+	c->in_use--;
+	if (s->free_cnt < c->objs_per_slab)
+		list_push_front (&c->partial, &s->elem);
+	else if (c->empty_cnt < EMPTY_MAX) {
+		list_push_front (&c->empty, &s->elem);
+		c->empty_cnt++;
+	} else {
+		victim = s;
+		c->slab_cnt--;
+	}
+	spin_unlock_irqrestore (&c->lock, old_level);
+
+	if (victim != NULL)
+		slab_destroy (victim);
+}
+
+/* Prints statistics for each cache that has been used. */
+void
+kmem_print_stats (void) {
+	struct list_elem *e;
+
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+		size_t capacity = c->slab_cnt * c->objs_per_slab;
+
+		if (c->hit_cnt + c->miss_cnt == 0)
+			continue;
+		printf ("Slab cache %s: %'lld hits, %'lld misses, "
+				"%zu of %zu objects in use (%zu%%) in %zu slabs\n",
+				c->name, c->hit_cnt, c->miss_cnt, c->in_use, capacity,
+				capacity > 0 ? c->in_use * 100 / capacity : 0, c->slab_cnt);
+	}
+}
+
+/* Creates and returns a slab for cache C with all its objects
+   free and constructed, or returns a null pointer if memory is
+   not available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	size_t i;
+
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free_cnt = c->objs_per_slab;
+
+	/* Hand out the objects in address order. */
+	for (i = 0; i < c->objs_per_slab; i++)
+		s->free_idx[i] = c->objs_per_slab - 1 - i;
+	if (c->ctor != NULL)
+		for (i = 0; i < c->objs_per_slab; i++)
+			c->ctor ((uint8_t *) s + c->obj_ofs + c->obj_size * i);
+
+	return s;
+}
+
+/* Gives slab S back to the page allocator. */
+static void
+slab_destroy (struct slab *s) {
+	ASSERT (s->magic == SLAB_MAGIC);
+
+	s->magic = 0;
+	palloc_free_page (s);
+}
+
+/* Destroys every slab in LIST. */
+static void
+destroy_list (struct list *list) {
+	while (!list_empty (list))
+		slab_destroy (list_entry (list_pop_front (list), struct slab, elem));
+}
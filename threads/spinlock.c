@@ -0,0 +1,70 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/interrupt.h"
+
+/* Initializes LOCK as free. */
+void
+spin_init (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	lock->locked = 0;
+}
+
+/* Acquires LOCK, spinning until it is free.  Interrupts must be
+   off. */
+void
+spin_lock (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+		/* Wait with plain reads, which do not take the cache line
+		   away from the holder, until the lock looks free. */
+		while (lock->locked)
+			asm volatile ("pause");
+	}
+}
+
+/* Tries to acquire LOCK without spinning.  Returns true if
+   successful, false if LOCK is held.  Interrupts must be off. */
+bool
+spin_trylock (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	return !__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE);
+}
+
+/* Releases LOCK, which must be held. */
+void
+spin_unlock (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (lock->locked);
+
+	__atomic_store_n (&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+/* Returns true if some CPU holds LOCK.  Only useful in
+   assertions. */
+bool
+spin_is_locked (const struct spinlock *lock) {
+	return lock->locked != 0;
+}
+
+/* Turns interrupts off, acquires LOCK, and returns the previous
+   interrupt level. */
+enum intr_level
+spin_lock_irqsave (struct spinlock *lock) {
+	enum intr_level old_level = intr_disable ();
+
+	spin_lock (lock);
+	return old_level;
+}
+
+/* Releases LOCK and restores the interrupt level to OLD_LEVEL. */
+void
+spin_unlock_irqrestore (struct spinlock *lock, enum intr_level old_level) {
+	spin_unlock (lock);
+	intr_set_level (old_level);
+}
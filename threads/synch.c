@@ -31,6 +31,13 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+static void sema_enqueue (struct semaphore *, struct thread *);
+static bool sema_down_until (struct semaphore *, int64_t deadline);
+static bool lock_acquire_until (struct lock *, int64_t deadline);
+static int lock_priority (struct lock *);
+static void update_donation (struct thread *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -40,13 +47,47 @@
    decrement it.
 
    - up or "V": increment the value (and wake up one waiting
-   thread, if any). */
+   thread, if any).
+
+   Waiters are kept in a heap ordered by priority, so "up" wakes
+   the highest-priority waiter, and among equals the one that has
+   waited longest. */
 void
 sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
+	spin_init (&sema->lock);
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, waiter_more, NULL);
+	sema->next_seq = 0;
+}
+
+/* Returns true if waiting thread A should be woken before B.
+   Orders threads queued through their `wait_elem' by priority,
+   then by `wait_seq'. */
+bool
+waiter_more (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+	const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return (int) (a->wait_seq - b->wait_seq) < 0;
+}
+
+/* Queues T, which is about to block, on SEMA's waiters.  Called
+   with SEMA's spinlock held.  Unless T is already queued on a
+   condition variable, a change of T's priority re-sorts it within
+   SEMA's waiters from now on. */
+static void
+sema_enqueue (struct semaphore *sema, struct thread *t) {
+	t->wait_seq = sema->next_seq++;
+	heap_push (&sema->waiters, &t->wait_elem);
+	if (t->wait_heap == NULL) {
+		t->wait_heap = &sema->waiters;
+		t->wait_node = &t->wait_elem;
+	}
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -59,21 +100,51 @@ sema_init (struct semaphore *sema, unsigned value) {
    sema_down function. */
 void
 sema_down (struct semaphore *sema) {
+	sema_down_until (sema, INT64_MAX);
+}
+
+/* Like sema_down(), but gives up if SEMA's value does not become
+   positive within TIMEOUT timer ticks.  Returns true if SEMA was
+   decremented, false if the wait timed out. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t timeout) {
+	return sema_down_until (sema, timer_ticks () + timeout);
+}
+
+/* Does the work of sema_down() and sema_down_timeout(), giving
+   up at tick DEADLINE, which may be INT64_MAX to wait forever. */
+static bool
+sema_down_until (struct semaphore *sema, int64_t deadline) {
+	struct thread *cur = thread_current ();
 	enum intr_level old_level;
+	bool timed_out = false;
 
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
-	old_level = intr_disable ();
+	old_level = spin_lock_irqsave (&sema->lock);
 	while (sema->value == 0) {
-		// list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, cmp_priority, NULL);
-		// printf("im die\n");
-		thread_block ();
-		// printf("im alive tid :%d prior:%d\n", thread_current()->tid, thread_current()->priority);
+		bool tracked;
+
+		if (timed_out) {
+			spin_unlock_irqrestore (&sema->lock, old_level);
+			return false;
+		}
+		sema_enqueue (sema, cur);
+		tracked = cur->wait_heap == &sema->waiters;
+		spin_unlock (&sema->lock);
+		timed_out = thread_block_until (deadline);
+		spin_lock (&sema->lock);
+
+		/* A timeout takes us off the queue that our priority is
+		   tracked in.  Inside cond_wait_timeout() that is the
+		   condition's queue, so leave SEMA's ourselves. */
+		if (timed_out && !tracked)
+			heap_remove (&sema->waiters, &cur->wait_elem);
 	}
 	sema->value--;
-	intr_set_level (old_level);
+	spin_unlock_irqrestore (&sema->lock, old_level);
+	return true;
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -88,7 +159,7 @@ sema_try_down (struct semaphore *sema) {
 
 	ASSERT (sema != NULL);
 
-	old_level = intr_disable ();
+	old_level = spin_lock_irqsave (&sema->lock);
 	if (sema->value > 0)
 	{
 		sema->value--;
@@ -96,7 +167,7 @@ sema_try_down (struct semaphore *sema) {
 	}
 	else
 		success = false;
-	intr_set_level (old_level);
+	spin_unlock_irqrestore (&sema->lock, old_level);
 
 	return success;
 }
@@ -111,14 +182,17 @@ sema_up (struct semaphore *sema) {
 
 	ASSERT (sema != NULL);
 
-	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){
-		// sema내부에서 priority 변경되었을 수도 있으므로 한번더 정렬
-		list_sort(&sema->waiters, cmp_priority, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
+	old_level = spin_lock_irqsave (&sema->lock);
+	if (!heap_empty (&sema->waiters)) {
+		struct thread *t = heap_entry (heap_pop (&sema->waiters),
+				struct thread, wait_elem);
+
+		if (t->wait_heap == &sema->waiters)
+			t->wait_heap = NULL;
+		thread_unblock (t);
 	}
 	sema->value++;
+	spin_unlock (&sema->lock);
 
 	// thread_yield()가 thread_unblock()으로 가면 오류가 발생함 --> 확인 필요
 	test_max_priority();
@@ -181,6 +255,20 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lockstat_init (&lock->stat, NULL);
+}
+
+/* Initializes LOCK like lock_init() and names it NAME, so that
+   its contention statistics are printed at shutdown.  LOCK must
+   live as long as the kernel. */
+void
+lock_init_named (struct lock *lock, const char *name) {
+	ASSERT (lock != NULL);
+	ASSERT (name != NULL);
+
+	lock->holder = NULL;
+	sema_init (&lock->semaphore, 1);
+	lockstat_init (&lock->stat, name);
 }
 
 
@@ -194,65 +282,106 @@ lock_init (struct lock *lock) {
    we need to sleep. */
 void
 lock_acquire (struct lock *lock) {
+	lock_acquire_until (lock, INT64_MAX);
+}
+
+/* Like lock_acquire(), but gives up if LOCK does not become
+   available within TIMEOUT timer ticks.  Returns true if LOCK
+   was acquired, false if the wait timed out. */
+bool
+lock_acquire_timeout (struct lock *lock, int64_t timeout) {
+	return lock_acquire_until (lock, timer_ticks () + timeout);
+}
+
+/* Does the work of lock_acquire() and lock_acquire_timeout(),
+   giving up at tick DEADLINE, which may be INT64_MAX to wait
+   forever. */
+static bool
+lock_acquire_until (struct lock *lock, int64_t deadline) {
+	struct thread *cur = thread_current ();
+	struct semaphore *sema = &lock->semaphore;
 	enum intr_level old_level;
-	old_level = intr_disable ();
+	int64_t wait_start = -1;
+	int64_t wait_tick = 0;
+	int64_t waited = -1;
+	bool timed_out = false;
 
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	// // holder의 lock이 있으면 동작
-	if (lock->holder != NULL){
+	old_level = intr_disable ();
+
+	/* This is sema_down_until(), except that a thread that has to
+	   wait lends its priority to the holder once it is queued. */
+	spin_lock (&sema->lock);
+	while (sema->value == 0) {
+		if (timed_out)
+			break;
+		if (wait_start < 0) {
+			wait_start = timer_ns ();
+			wait_tick = timer_ticks ();
+		}
 		// lock의 주소 저장
-		thread_current()->wait_on_lock = lock;
-		
-		// donation을 받은 스레드의 thread구조체를 list로 관리
-		// -> 락을 가지고있는 스레드의 donation_list에 현재 쓰레드를 정렬해서 넣어줌
-		// list_push_back(&lock->holder->donations, &thread_current()->donation_elem);
-		list_insert_ordered(&lock->holder->donations, &thread_current()->donation_elem, cmp_priority_dona, NULL);		
-		donate_priority();
+		cur->wait_on_lock = lock;
+		sema_enqueue (sema, cur);
+		spin_unlock (&sema->lock);
+
+		// holder의 lock이 있으면 동작 (MLFQS에서는 donation 없음)
+		if (!thread_mlfqs)
+			donate_priority ();
+		timed_out = thread_block_until (deadline);
+		spin_lock (&sema->lock);
+	}
+	/* Like sema_down_until(), a release that came after the
+	   timeout still counts: leaving it would lose the token. */
+	if (sema->value > 0) {
+		sema->value--;
+		timed_out = false;
+	} else
+		timed_out = true;
+	spin_unlock (&sema->lock);
+
+	if (wait_start >= 0) {
+		waited = timer_ns () - wait_start;
+		thread_current ()->usage.lock_wait_ticks += timer_ticks () - wait_tick;
 	}
-	sema_down (&lock->semaphore);
 	// 기다리고 있는 lock 값 초기화 
 	thread_current() -> wait_on_lock = NULL;
 
+	if (timed_out) {
+		/* We are off LOCK's waiters, so the holder may have been
+		   lent too much. */
+		if (!thread_mlfqs && lock->holder != NULL) {
+			heap_update (&lock->holder->held_locks, &lock->held_elem);
+			update_donation (lock->holder);
+		}
+		intr_set_level (old_level);
+		return false;
+	}
+
 	// lock을 획득 한 후 lock holder 갱신
-	lock->holder = thread_current ();
+	lock->holder = cur;
+	heap_push (&cur->held_locks, &lock->held_elem);
+	lockstat_acquired (&lock->stat, waited);
+	lockstat_hold (&lock->stat);
 	intr_set_level (old_level);
+	return true;
 }
 
+/* Lends the current thread's priority to the holder of the lock
+   it is waiting for, which must already count the current thread
+   among its waiters.  If that holder is waiting for a lock in
+   turn, the donation is passed on, up to 8 holders deep. */
+void
+donate_priority (void) {
+	struct lock *lock = thread_current ()->wait_on_lock;
 
-// donations 리스트의 priority값을 나에게 할당함
-void donate_priority(void){
-	/* priority donation 을 수행하는 함수를 구현한다.
-	현재 스레드가 기다리고 있는 lock 과 연결 된 모든 스레드들을 순회하며 
-	현재 스레드의 우선순위를 lock 을 보유하고 있는 스레드에게 기부 한다. 
-	nested depth 는 8로 제한한다. */
-
-	struct lock * c_lock = thread_current()->wait_on_lock;
-
-	int nested_count = 1;
-
-	if (strcmp(thread_name(),"idle") == 0){
+	if (lock == NULL || lock->holder == NULL)
 		return;
-	}
-	// nested depth 8로 제한
-	while(nested_count <=8){
-		if (c_lock->holder->init_priority== -1){
-				// 이전 priority 기억
-				c_lock->holder->init_priority = c_lock->holder->priority;
-		}
-		// priority 기부(크다면)
-		if(c_lock->holder->priority < thread_get_priority()){	
-			c_lock->holder->priority = thread_get_priority();
-		}
-		// 다음 nested thread
-		nested_count ++;
-		if (c_lock->holder->wait_on_lock == NULL){
-			break;
-		}
-		c_lock = (c_lock->holder->wait_on_lock);
-	}
+
+	heap_update (&lock->holder->held_locks, &lock->held_elem);
+	update_donation (lock->holder);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -263,14 +392,21 @@ void donate_priority(void){
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current ();
+		heap_push (&lock->holder->held_locks, &lock->held_elem);
+		lockstat_acquired (&lock->stat, -1);
+		lockstat_hold (&lock->stat);
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -288,54 +424,85 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if ( !list_empty(&thread_current()->donations) ){
-		remove_with_lock(lock);
-		refresh_priority();	
-	}
+	// lock을 기다리던 스레드들의 donation 회수
+	heap_remove (&thread_current ()->held_locks, &lock->held_elem);
+	if (!thread_mlfqs)
+		refresh_priority ();
+	lockstat_unhold (&lock->stat);
 	lock->holder = NULL;
 	sema_up (&lock->semaphore);
 	intr_set_level (old_level);
 }
 
+/* Recomputes the current thread's priority after it has given
+   up a lock or changed its base priority. */
 void
-remove_with_lock(struct lock *lock){
-	// 1. lock 해지시 donation리스트에서 donation 해준 스레드 삭제
-	// 1-1. 현재 스레드의 donation thread 중에 동일한 lock 을 보유하고 있는 것을 삭제한다.
-	struct list_elem *w_e;
-	struct list_elem *d_e;
-
-	// 락의 waiter기준으로 donation을 순회하면 지워준다.(락에 포함되는 donator 스레드 삭제)
-	for (w_e = list_begin(&lock->semaphore.waiters); w_e!= list_end(&lock->semaphore.waiters); w_e = list_next(w_e)){
-		struct thread * w_thread = list_entry(w_e, struct thread, elem);
-		for (d_e = list_begin(&thread_current()->donations); d_e!= list_end(&thread_current()->donations); d_e = list_next(d_e)){
-			struct thread * d_thread = list_entry(d_e, struct thread, donation_elem);
-			if (w_thread->tid == d_thread->tid){
-				list_remove(d_e);
-				d_e = list_prev(d_e);
-			}
+refresh_priority (void) {
+	update_donation (thread_current ());
+}
 
-		}
-	}
+/* Returns the priority that the waiters of LOCK lend its holder,
+   or PRI_MIN - 1 if nobody waits for LOCK. */
+static int
+lock_priority (struct lock *lock) {
+	struct heap_elem *top = heap_top (&lock->semaphore.waiters);
+
+	return top != NULL
+		? heap_entry (top, struct thread, wait_elem)->priority : PRI_MIN - 1;
 }
 
+/* Returns true if held lock A lends more priority than B.  Every
+   thread keeps the locks it holds in a heap ordered by this. */
+bool
+lock_more (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return lock_priority (heap_entry (a, struct lock, held_elem))
+		> lock_priority (heap_entry (b, struct lock, held_elem));
+}
 
-void 
-refresh_priority(void){
-	// 1.donation에 다른 값이 존재한다면 가장 높은 우선순위 돌려주기
-	if ( !list_empty(&thread_current()->donations) ){
-		list_sort(&thread_current()->donations, cmp_priority_dona, NULL);
+/* Returns the priority T should run at: its base priority, or
+   more if the waiters of a lock it holds lend it more. */
+static int
+effective_priority (struct thread *t) {
+	struct heap_elem *top = heap_top (&t->held_locks);
+	int priority = t->base_priority;
+
+	if (top != NULL
+			&& lock_priority (heap_entry (top, struct lock, held_elem)) > priority)
+		priority = lock_priority (heap_entry (top, struct lock, held_elem));
+	if (t->rw_priority > priority)
+		priority = t->rw_priority;
+	return priority;
+}
 
-		struct thread *next_priority_thread = list_entry(list_front(&thread_current()->donations), struct thread, donation_elem);
-		thread_current()-> priority = next_priority_thread->priority;	
-	}
-	else {
-		// 2.없다면 thread priority 돌려주기
-		thread_current()->priority = thread_current()->init_priority;
-		thread_current()->init_priority = -1;
+/* Brings T's priority up to date with the donations it holds.
+   If it changes and T is waiting for a lock, the holder of that
+   lock is updated in turn, and so on, up to 8 holders deep.
+   Interrupts must be off. */
+static void
+update_donation (struct thread *t) {
+	int depth;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (depth = 0; t != NULL && depth < 8; depth++) {
+		int priority = effective_priority (t);
+		struct lock *lock;
+
+		if (priority == t->priority)
+			break;
+		if (priority > t->priority)
+			thread_trace (TRACE_DONATE, t, priority);
+		thread_update_priority (t, priority);
+
+		lock = t->wait_on_lock;
+		if (lock == NULL || lock->holder == NULL)
+			break;
+		heap_update (&lock->holder->held_locks, &lock->held_elem);
+		t = lock->holder;
 	}
 }
 
-
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -346,12 +513,306 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem {
+/* A thread waiting for a reader-writer lock. */
+struct rw_waiter {
 	struct list_elem elem;              /* List element. */
+	struct thread *thread;              /* Waiting thread. */
+	struct semaphore semaphore;         /* Upped once it holds the lock. */
+};
+
+static int64_t rw_wait (struct rwlock *, struct list *queue);
+static void rw_grant (struct rwlock *, struct list *wake);
+static void rw_wake (struct list *wake);
+static void rw_donate (struct rwlock *);
+static void rw_restore_priority (void);
+
+/* Initializes RW.  A reader-writer lock can be held either
+   shared, by any number of readers at once, or exclusive, by a
+   single writer.
+
+   It prefers writers: once a writer is waiting, new readers
+   wait behind it, and when the lock becomes free a waiting
+   writer gets it before the waiting readers, which are then let
+   in together.  Like a lock, it has owners, so every thread
+   that waits for it donates its priority to all of the threads
+   that currently hold it.  A thread may hold at most one
+   reader-writer lock shared at a time, and, as with locks,
+   acquiring one that it already holds is an error. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	spin_init (&rw->lock);
+	rw->writer = NULL;
+	list_init (&rw->readers);
+	list_init (&rw->read_waiters);
+	list_init (&rw->write_waiters);
+	lockstat_init (&rw->stat, NULL);
+}
+
+/* Initializes RW like rwlock_init() and names it NAME, so that
+   its contention statistics are printed at shutdown.  RW must
+   live as long as the kernel. */
+void
+rwlock_init_named (struct rwlock *rw, const char *name) {
+	ASSERT (name != NULL);
+
+	rwlock_init (rw);
+	lockstat_init (&rw->stat, name);
+}
+
+/* Acquires RW shared, sleeping while a writer holds it or waits
+   for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (cur->rw_read == NULL);
+	ASSERT (rw->writer != cur);
+
+	old_level = spin_lock_irqsave (&rw->lock);
+	if (rw->writer == NULL && list_empty (&rw->write_waiters)) {
+		if (list_empty (&rw->readers))
+			lockstat_hold (&rw->stat);
+		cur->rw_read = rw;
+		list_push_back (&rw->readers, &cur->rw_elem);
+		lockstat_acquired (&rw->stat, -1);
+	} else
+		lockstat_acquired (&rw->stat, rw_wait (rw, &rw->read_waiters));
+	spin_unlock_irqrestore (&rw->lock, old_level);
+}
+
+/* Releases RW, which the current thread must hold shared. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+	struct list wake;
+
+	ASSERT (rw != NULL);
+	ASSERT (cur->rw_read == rw);
+
+	list_init (&wake);
+	old_level = spin_lock_irqsave (&rw->lock);
+	list_remove (&cur->rw_elem);
+	cur->rw_read = NULL;
+	rw_grant (rw, &wake);
+	spin_unlock (&rw->lock);
+
+	rw_restore_priority ();
+	rw_wake (&wake);
+	test_max_priority ();
+	intr_set_level (old_level);
+}
+
+/* Acquires RW exclusive, sleeping until no other thread holds
+   it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rw));
+
+	old_level = spin_lock_irqsave (&rw->lock);
+	if (rw->writer == NULL && list_empty (&rw->readers)) {
+		rw->writer = cur;
+		lockstat_hold (&rw->stat);
+		lockstat_acquired (&rw->stat, -1);
+	} else
+		lockstat_acquired (&rw->stat, rw_wait (rw, &rw->write_waiters));
+	spin_unlock_irqrestore (&rw->lock, old_level);
+}
+
+/* Releases RW, which the current thread must hold exclusive. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	enum intr_level old_level;
+	struct list wake;
+
+	ASSERT (rw != NULL);
+	ASSERT (rw->writer == thread_current ());
+
+	list_init (&wake);
+	old_level = spin_lock_irqsave (&rw->lock);
+	rw->writer = NULL;
+	rw_grant (rw, &wake);
+	spin_unlock (&rw->lock);
+
+	rw_restore_priority ();
+	rw_wake (&wake);
+	test_max_priority ();
+	intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW, either shared or
+   exclusive, false otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) {
+	struct thread *cur = thread_current ();
+
+	ASSERT (rw != NULL);
+
+	return rw->writer == cur || cur->rw_read == rw;
+}
+
+/* Queues the current thread on QUEUE, one of RW's wait lists,
+   and sleeps until a releasing thread hands RW over to it.
+   Called with RW's spinlock held, which it drops while
+   sleeping.  Returns the number of nanoseconds it slept. */
+static int64_t
+rw_wait (struct rwlock *rw, struct list *queue) {
+	struct rw_waiter waiter;
+	int64_t wait_start = timer_ns ();
+	int64_t wait_tick = timer_ticks ();
+
+	waiter.thread = thread_current ();
+	sema_init (&waiter.semaphore, 0);
+	list_push_back (queue, &waiter.elem);
+	rw_donate (rw);
+
+	spin_unlock (&rw->lock);
+	sema_down (&waiter.semaphore);
+	spin_lock (&rw->lock);
+
+	thread_current ()->usage.lock_wait_ticks += timer_ticks () - wait_tick;
+	return timer_ns () - wait_start;
+}
+
+/* Returns true if waiter A has lower priority than waiter B. */
+static bool
+rw_waiter_less (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct rw_waiter, elem)->thread->priority
+		< list_entry (b, struct rw_waiter, elem)->thread->priority;
+}
+
+/* If nobody holds RW, hands it to the highest-priority waiting
+   writer or, if there is none, to all of the waiting readers,
+   and moves their waiters to WAKE.  The new holders count as
+   holders at once; rw_wake() lets them run after RW's spinlock
+   is dropped, so that a woken thread that preempts us cannot
+   spin on it. */
+static void
+rw_grant (struct rwlock *rw, struct list *wake) {
+	struct rw_waiter *w;
+
+	if (rw->writer != NULL || !list_empty (&rw->readers))
+		return;
+
+	lockstat_unhold (&rw->stat);
+	if (!list_empty (&rw->write_waiters) || !list_empty (&rw->read_waiters))
+		lockstat_hold (&rw->stat);
+	if (!list_empty (&rw->write_waiters)) {
+		w = list_entry (list_max (&rw->write_waiters, rw_waiter_less, NULL),
+				struct rw_waiter, elem);
+		list_remove (&w->elem);
+		rw->writer = w->thread;
+		list_push_back (wake, &w->elem);
+	} else
+		while (!list_empty (&rw->read_waiters)) {
+			w = list_entry (list_pop_front (&rw->read_waiters),
+					struct rw_waiter, elem);
+			w->thread->rw_read = rw;
+			list_push_back (&rw->readers, &w->thread->rw_elem);
+			list_push_back (wake, &w->elem);
+		}
+
+	/* Whoever is still waiting now waits for the new holders. */
+	rw_donate (rw);
+}
+
+/* Wakes up the waiters in WAKE. */
+static void
+rw_wake (struct list *wake) {
+	while (!list_empty (wake))
+		sema_up (&list_entry (list_pop_front (wake),
+					struct rw_waiter, elem)->semaphore);
+}
+
+/* Raises the priority that T is lent through reader-writer locks
+   to at least PRIORITY, and passes the change on to the holders
+   of the locks that T is waiting for, as in donate_priority(). */
+static void
+donate_to (struct thread *t, int priority) {
+	if (t->rw_priority < priority) {
+		t->rw_priority = priority;
+		update_donation (t);
+	}
+}
+
+/* Donates the priority of the highest-priority thread waiting
+   for RW to every thread that holds RW.  Called with RW's
+   spinlock held. */
+static void
+rw_donate (struct rwlock *rw) {
+	struct list_elem *e;
+	int priority = PRI_MIN - 1;
+
+	if (thread_mlfqs)
+		return;
+
+	for (e = list_begin (&rw->write_waiters); e != list_end (&rw->write_waiters);
+			e = list_next (e))
+		if (list_entry (e, struct rw_waiter, elem)->thread->priority > priority)
+			priority = list_entry (e, struct rw_waiter, elem)->thread->priority;
+	for (e = list_begin (&rw->read_waiters); e != list_end (&rw->read_waiters);
+			e = list_next (e))
+		if (list_entry (e, struct rw_waiter, elem)->thread->priority > priority)
+			priority = list_entry (e, struct rw_waiter, elem)->thread->priority;
+	if (priority < PRI_MIN)
+		return;
+
+	if (rw->writer != NULL)
+		donate_to (rw->writer, priority);
+	for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+			e = list_next (e))
+		donate_to (list_entry (e, struct thread, rw_elem), priority);
+}
+
+/* Gives back whatever priority the current thread was lent
+   while it held a reader-writer lock, keeping what the waiters
+   for its locks still lend it. */
+static void
+rw_restore_priority (void) {
+	if (!thread_mlfqs && thread_current ()->rw_priority >= PRI_MIN) {
+		thread_current ()->rw_priority = PRI_MIN - 1;
+		refresh_priority ();
+	}
+}
+
+/* One semaphore in a condition variable's waiters. */
+struct semaphore_elem {
+	struct heap_elem elem;              /* Heap element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Thread waiting on it. */
+	unsigned seq;                       /* Arrival order. */
 };
 
+/* Returns true if the thread waiting on condition variable
+   waiter A should be signaled before the one waiting on B. */
+static bool
+cond_waiter_more (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct semaphore_elem *a = heap_entry (a_, struct semaphore_elem, elem);
+	const struct semaphore_elem *b = heap_entry (b_, struct semaphore_elem, elem);
+
+	if (a->thread->priority != b->thread->priority)
+		return a->thread->priority > b->thread->priority;
+	return (int) (a->seq - b->seq) < 0;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -359,7 +820,8 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	heap_init (&cond->waiters, cond_waiter_more, NULL);
+	cond->next_seq = 0;
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -384,7 +846,20 @@ cond_init (struct condition *cond) {
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
+	cond_wait_timeout (cond, lock, -1);
+}
+
+/* Like cond_wait(), but stops waiting for COND to be signaled
+   after TIMEOUT timer ticks, if TIMEOUT is not negative.  LOCK is
+   reacquired in either case.  Returns true if COND was
+   signaled, false if the wait timed out. */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock,
+		int64_t timeout) {
+	struct thread *cur = thread_current ();
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
+	bool signaled;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -392,10 +867,22 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	list_push_back (&cond->waiters, &waiter.elem);
+	waiter.thread = cur;
+
+	/* Until signaled, a change of our priority re-sorts us among
+	   COND's waiters. */
+	old_level = intr_disable ();
+	waiter.seq = cond->next_seq++;
+	heap_push (&cond->waiters, &waiter.elem);
+	cur->wait_heap = &cond->waiters;
+	cur->wait_node = &waiter.elem;
+	intr_set_level (old_level);
+
 	lock_release (lock);
-	sema_down (&waiter.semaphore);
+	signaled = sema_down_until (&waiter.semaphore,
+			timeout < 0 ? INT64_MAX : timer_ticks () + timeout);
 	lock_acquire (lock);
+	return signaled;
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
@@ -405,29 +892,24 @@ cond_wait (struct condition *cond, struct lock *lock) {
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
-bool
-cmp_priority_waiter (struct list_elem *a, struct list_elem *b, void* aux){
-	struct semaphore_elem *t_a = list_entry(a, struct semaphore_elem, elem);
-	struct semaphore_elem *t_b = list_entry(b, struct semaphore_elem, elem);
-
-	struct list *waiter_a_sema = &(t_a->semaphore.waiters);
-	struct list *waiter_b_sema = &(t_b->semaphore.waiters);
-
-	return (list_entry(list_begin(waiter_a_sema), struct thread, elem)->priority) > 
-			(list_entry(list_begin(waiter_b_sema), struct thread, elem)->priority);
-}
-
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		list_sort(&cond->waiters, cmp_priority_waiter, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	if (!heap_empty (&cond->waiters)) {
+		struct semaphore_elem *waiter = heap_entry (heap_pop (&cond->waiters),
+				struct semaphore_elem, elem);
+
+		waiter->thread->wait_heap = NULL;
+		sema_up (&waiter->semaphore);
+	}
+	intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -441,7 +923,7 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!heap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
 
@@ -468,27 +950,3 @@ list_print_elem(struct list *list){
 	printf("===========\n");
 	return;
 }
-
-// donators 리스트 프린트 함수 
-void 
-list_print_dona_elem(struct list *list){
-	int i = 0;
-	struct list_elem *e;
-	printf("===========\n");
-	printf("LIST현황 확인\n");
-	if (list_empty(list)){
-		printf("빈 리스트 입니다.\n");
-	}
-	else {
-		printf("값이 있는 리스트 입니다.\n");
-		for (e = list_begin(list); e != list_end(list); e = list_next(e)){
-			i++;
-			struct thread *t = list_entry(e, struct thread, donation_elem);
-			printf("%d 번째 tid : %d  priority : %d\n", i, t->tid, t->priority);
-		}
-	}
-	printf("LIST순회 종료\n");
-	printf("===========\n");
-	return;
-}
-
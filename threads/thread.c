@@ -4,10 +4,13 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
@@ -25,52 +28,149 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Per-CPU state, including the run queues of processes in
+   THREAD_READY state, that is, processes that are ready to run
+   but not actually running.  See cpu.h.  Only the bootstrap
+   processor, cpus[0], is brought up, so cpu_cnt is 1.
 
-/* Idle thread. */
-static struct thread *idle_thread;
+   Under the stride scheduler the thread with the lowest pass
+   runs next.  Threads that join a run queue are not let behind
+   the pass of the thread most recently scheduled there, so that
+   sleeping does not bank CPU time. */
+struct cpu cpus[CPU_MAX];
+int cpu_cnt = 1;
+
+/* A thread with T tickets has its pass advanced by STRIDE1 / T
+   for every tick it runs. */
+#define STRIDE1 (1 << 20)
+
+/* List of all live threads.  Threads are added when they are
+   first initialized and removed when they exit. */
+static struct list all_list;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
+/* Cache of child_info structures, one per thread created. */
+struct kmem_cache *child_info_cache;
+
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
 /* Thread destruction requests */
 static struct list destruction_req;
 
-/* List of processes in THREAD_BLOCKED and sleeping by timer_sleep() */
-static struct list sleep_list;
-static struct lock sleep_lock;
+/* Pages of dead threads kept for reuse by thread_create(), linked
+   through their `elem' members.  init_thread() re-initializes
+   the struct thread at the bottom of a page, so a recycled page
+   needs no zeroing.  At most thread_cache_max pages are kept;
+   the rest go back to the page allocator. */
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+size_t thread_cache_max = 16;
+
+/* Processes in THREAD_BLOCKED state sleeping in timer_sleep(),
+   in a min-heap ordered by wakeup tick. */
+static struct heap sleep_heap;
 
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long cache_hits;    /* # of thread pages taken from the cache. */
+static long long cache_misses;  /* # of thread pages from palloc. */
 
 
+/* Earliest wakeup tick in sleep_heap, or INT64_MAX if nobody is
+   sleeping.  Lets the timer interrupt skip thread_awake(). */
 static int64_t next_tick;
 
+/* MLFQS state. */
+static fixed_t load_avg;                /* System load average. */
+static struct thread *mlfqs_thread;     /* Once-per-second updater. */
+static struct semaphore mlfqs_tick_sema; /* Upped at each second. */
+
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the stride scheduler.  Controlled by kernel
+   command-line option "-stride". */
+bool thread_stride;
+
+/* If true (default), switch between kernel threads with
+   context_switch().  If false, save the whole intr_frame. */
+bool thread_fast_switch = true;
+
+/* If true, print each process's resource usage when it exits. */
+bool thread_report_usage;
+
+/* Scheduler event trace.
+
+   A fixed-size ring of the most recent TRACE_CNT scheduler
+   events, each stamped with the timer tick and timer_ns().  Every
+   event is recorded with interrupts off, which is all the mutual
+   exclusion a single CPU needs, so recording takes no lock and
+   never sleeps.  Once the ring is full the oldest events are
+   overwritten.  thread_trace_dump() prints the ring; see
+   utils/sched-trace for a tool that turns the dump into latency
+   histograms and per-thread timelines. */
+#define TRACE_CNT 4096          /* Must be a power of 2. */
+
+struct trace_rec {
+	int64_t ns;                 /* timer_ns() at the event. */
+	int64_t tick;               /* timer_ticks() at the event. */
+	tid_t tid;                  /* Thread the event is about. */
+	int arg;                    /* Depends on TYPE. */
+	enum trace_type type;
+	char name[16];              /* Name of the thread. */
+};
+
+bool thread_trace_enabled;
+static struct trace_rec trace_buf[TRACE_CNT];
+static uint64_t trace_head;     /* Total number of events recorded. */
+
+static const char *trace_names[] = {
+	[TRACE_SWITCH_OUT] = "out",
+	[TRACE_SWITCH_IN] = "in",
+	[TRACE_BLOCK] = "block",
+	[TRACE_UNBLOCK] = "unblock",
+	[TRACE_WAKEUP] = "wakeup",
+	[TRACE_DONATE] = "donate",
+};
+
+static void trace_inspect (struct intr_frame *);
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static void mlfqs_daemon (void *aux);
+static void mlfqs_tick (struct thread *);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_update_priority (struct thread *);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static bool wakeup_less (const struct heap_elem *, const struct heap_elem *,
+		void *);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static int ready_threads (void);
+static struct thread *rq_pop (struct cpu *);
+static bool is_idle (const struct thread *);
+static void init_cpu (struct cpu *, int id);
+static bool pass_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -119,11 +219,13 @@ thread_init (void) {
 	lgdt (&gdt_ds);
 
 	/* Init the globla thread context */
-	lock_init (&tid_lock);
-	lock_init (&sleep_lock);
-	list_init (&ready_list);
+	lock_init_named (&tid_lock, "tid");
+	init_cpu (&cpus[0], 0);
+	list_init (&all_list);
 	list_init (&destruction_req);
-	list_init (&sleep_list);
+	list_init (&thread_cache);
+	heap_init (&sleep_heap, wakeup_less, NULL);
+	next_tick = INT64_MAX;
 
 
 	/* Set up a thread structure for the running thread. */
@@ -140,6 +242,11 @@ thread_init (void) {
 */
 void
 thread_start (void) {
+	child_info_cache = kmem_cache_create ("child_info",
+			sizeof (struct child_info), NULL);
+	if (child_info_cache == NULL)
+		PANIC ("cannot create child_info cache");
+
 	/* Create the idle thread. */
 	struct semaphore idle_started;
 	sema_init (&idle_started, 0);
@@ -150,6 +257,19 @@ thread_start (void) {
 
 	/* Wait for the idle thread to initialize idle_thread. */
 	sema_down (&idle_started);
+
+	/* Let user programs dump the trace with int 0x45. */
+	intr_register_int (0x45, 3, INTR_OFF, trace_inspect,
+			"Dump Scheduler Trace");
+
+	/* Create the thread that does the MLFQS once-per-second pass. */
+	if (thread_mlfqs) {
+		struct semaphore mlfqs_started;
+		sema_init (&mlfqs_tick_sema, 0);
+		sema_init (&mlfqs_started, 0);
+		thread_create ("mlfqs", PRI_MAX, mlfqs_daemon, &mlfqs_started);
+		sema_down (&mlfqs_started);
+	}
 }
 
 /* Called by the timer interrupt handler at each timer tick.
@@ -159,25 +279,151 @@ thread_tick (void) {
 	struct thread *t = thread_current ();
 
 	/* Update statistics. */
-	if (t == idle_thread)
+	if (is_idle (t))
 		idle_ticks++;
-#ifdef USERPROG
-	else if (t->pml4 != NULL)
+	else if (intr_user_context ()) {
 		user_ticks++;
-#endif
-	else
+		t->usage.user_ticks++;
+	} else {
 		kernel_ticks++;
+		t->usage.kernel_ticks++;
+	}
+
+	if (thread_mlfqs)
+		mlfqs_tick (t);
+	else if (thread_stride && !is_idle (t))
+		t->pass += STRIDE1 / t->tickets;
 
-	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	/* Enforce preemption.  The MLFQS updater is never preempted,
+	   so that it can walk all_list without other threads running. */
+	if (++t->cpu->thread_ticks >= TIME_SLICE && t != mlfqs_thread)
 		intr_yield_on_return ();
 }
 
+/* MLFQS bookkeeping for a timer tick while T is running.  Only
+   T's recent_cpu changes from tick to tick, so only T's priority
+   is recomputed every fourth tick.  The load average is updated
+   here once per second, with the ready thread count kept by the
+   run queues; decaying recent_cpu for every thread is handed off
+   to mlfqs_daemon(). */
+static void
+mlfqs_tick (struct thread *t) {
+	int64_t now = timer_ticks ();
+	bool running = !is_idle (t) && t != mlfqs_thread;
+
+	if (running)
+		t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+	if (now % TIMER_FREQ == 0) {
+		load_avg = fp_add (fp_div_int (fp_mul_int (load_avg, 59), 60),
+				fp_div_int (fp_from_int (ready_threads () + running), 60));
+		sema_up (&mlfqs_tick_sema);
+	} else if (now % 4 == 0 && running) {
+		mlfqs_update_priority (t);
+		test_max_priority ();
+	}
+}
+
+/* Returns T's MLFQS priority, computed from its recent_cpu and
+   nice values. */
+static int
+mlfqs_priority (const struct thread *t) {
+	int priority = PRI_MAX - fp_to_int (fp_div_int (t->recent_cpu, 4))
+		- t->nice * 2;
+
+	if (priority < PRI_MIN)
+		return PRI_MIN;
+	if (priority > PRI_MAX)
+		return PRI_MAX;
+	return priority;
+}
+
+/* Recomputes T's MLFQS priority, moving T to its new run queue
+   if it is ready. */
+static void
+mlfqs_update_priority (struct thread *t) {
+	if (is_idle (t) || t == mlfqs_thread)
+		return;
+	thread_update_priority (t, mlfqs_priority (t));
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	printf ("Thread cache: %lld hits, %lld misses (%lld%% hit rate)\n",
+			cache_hits, cache_misses,
+			cache_hits + cache_misses > 0
+			? cache_hits * 100 / (cache_hits + cache_misses) : 0);
+}
+
+/* Records an event of the given TYPE about thread T in the
+   trace buffer, if tracing is enabled.  Interrupts must be off. */
+void
+thread_trace (enum trace_type type, struct thread *t, int arg) {
+	struct trace_rec *r;
+
+	if (!thread_trace_enabled)
+		return;
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	r = &trace_buf[trace_head++ & (TRACE_CNT - 1)];
+	r->ns = timer_ns ();
+	r->tick = timer_ticks ();
+	r->tid = t->tid;
+	r->arg = arg;
+	r->type = type;
+	strlcpy (r->name, t->name, sizeof r->name);
+}
+
+/* Prints the trace buffer, oldest event first, one event per
+   line:
+
+       trace: NS TICK EVENT TID ARG NAME
+
+   The dump is bracketed by "trace: begin" and "trace: end"
+   lines.  Tracing is paused while the buffer is printed. */
+void
+thread_trace_dump (void) {
+	uint64_t first, i;
+	bool enabled = thread_trace_enabled;
+
+	if (!enabled)
+		return;
+	thread_trace_enabled = false;
+
+	first = trace_head > TRACE_CNT ? trace_head - TRACE_CNT : 0;
+	printf ("trace: begin %llu events, %llu dropped\n",
+			(unsigned long long) (trace_head - first),
+			(unsigned long long) first);
+	for (i = first; i < trace_head; i++) {
+		const struct trace_rec *r = &trace_buf[i & (TRACE_CNT - 1)];
+		printf ("trace: %lld %lld %s %d %d %s\n",
+				(long long) r->ns, (long long) r->tick,
+				trace_names[r->type], r->tid, r->arg, r->name);
+	}
+	printf ("trace: end\n");
+
+	thread_trace_enabled = enabled;
+}
+
+/* Dumps the scheduler trace.  Invoked via int 0x45. */
+static void
+trace_inspect (struct intr_frame *f UNUSED) {
+	thread_trace_dump ();
+}
+
+/* Prints the resource usage of thread T. */
+void
+thread_print_usage (struct thread *t) {
+	const struct rusage *u = &t->usage;
+
+	printf ("%s: usage: %lld user ticks, %lld kernel ticks, "
+			"%lld ready ticks, %lld lock wait ticks, "
+			"%lld voluntary and %lld involuntary switches\n",
+			t->name, u->user_ticks, u->kernel_ticks, u->ready_ticks,
+			u->lock_wait_ticks, u->vol_switches, u->invol_switches);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -199,15 +445,27 @@ tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
 	struct thread *t;
+	struct child_info *my_info;
+	enum intr_level old_level;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 	
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = alloc_thread_page ();
 	if (t == NULL)
 		return TID_ERROR;
 
+	/* Allocate its child_info before T is on all_list, so that a
+	   failure here only has to give back the page. */
+	my_info = kmem_cache_alloc (child_info_cache);
+	if (my_info == NULL) {
+		old_level = intr_disable ();
+		free_thread_page (t);
+		intr_set_level (old_level);
+		return TID_ERROR;
+	}
+
 	/* Initialize thread. */
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
@@ -223,11 +481,11 @@ thread_create (const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-	struct child_info *my_info = (struct child_info *) malloc (sizeof (struct child_info));
 	t->my_info = my_info;
 	my_info->tid = t->tid;
 	my_info->exit_status = t->exit_status;
 	my_info->is_zombie = false;
+	my_info->is_thread = false;
 	my_info->child_thread = t;			 // child_thread 여기서 child는 my_info에 정보와 같은 thread
 	sema_init(&my_info->sema, 0);
 	list_push_back(&thread_current()->child_list, &my_info->elem_c);	// 부모(나)의 child_list에 지금 만들어지는 자식의 child_info 추가
@@ -253,37 +511,11 @@ void
 thread_block (void) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
+	thread_trace (TRACE_BLOCK, thread_current (), 0);
 	thread_current ()->status = THREAD_BLOCKED;
 	schedule ();
 }
 
-bool
-cmp_priority (struct list_elem *a, struct list_elem *b, void* aux){
-	// elem 전용
-	struct thread *t_a = list_entry(a, struct thread, elem);
-	struct thread *t_b = list_entry(b, struct thread, elem);
-
-	if (t_a->priority > t_b->priority){
-		return true;
-	}
-	else {
-		return false;
-	}
-}
-
-bool
-cmp_priority_dona (struct list_elem *a, struct list_elem *b, void* aux){
-	struct thread *t_a = list_entry(a, struct thread, donation_elem);
-	struct thread *t_b = list_entry(b, struct thread, donation_elem);
-
-	if (t_a->priority > t_b->priority){
-		return true;
-	}
-	else {
-		return false;
-	}
-}
-
 
 
 /* Transitions a blocked thread T to the ready-to-run state.
@@ -302,12 +534,15 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	
-	// list 기존에는 들어오는 순서대로 넣습니다.
-	// list_push_back (&ready_list, &t->elem);
-	// list priority 순으로 넣기
-	list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);
+	if (t->timed_wait) {
+		heap_remove (&sleep_heap, &t->sleep_elem);
+		t->timed_wait = false;
+	}
+
+	ready_push (t);
 	t->status = THREAD_READY;
+	t->ready_since = timer_ticks ();
+	thread_trace (TRACE_UNBLOCK, t, t->priority);
 
 	intr_set_level (old_level);
 }
@@ -355,6 +590,7 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	list_remove (&thread_current ()->all_elem);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -369,41 +605,74 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		// list_push_back (&ready_list, &curr->elem);
-		list_insert_ordered(&ready_list, &(thread_current()->elem), cmp_priority, NULL);
+	if (!is_idle (curr)) {
+		ready_push (curr);
+		curr->ready_since = timer_ticks ();
+	}
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
 
+/* Yields the CPU if a ready thread has a higher priority than
+   the running thread.  From an interrupt handler the yield is
+   deferred until the handler returns. */
 void
-test_max_priority (void)
-{	
-	// ready_list 비었는지 확인
-	if (!(list_empty(&ready_list))){
-		struct thread* max_priroty_thread = list_entry(list_begin(&ready_list), struct thread, elem);	
-		// thread_priority 비교 후 양보 필요시 양보
-		if(max_priroty_thread->priority > thread_current()->priority){
-			if (thread_current() != idle_thread){
-				thread_yield();
-			}
-		}
-	}
-	else{
+test_max_priority (void) {
+	struct thread *curr = thread_current ();
+
+	/* The stride scheduler ignores priorities. */
+	if (thread_stride)
+		return;
+
+	if (is_idle (curr) || ready_max_priority () <= curr->priority)
 		return;
+
+	if (intr_context ())
+		intr_yield_on_return ();
+	else
+		thread_yield ();
+}
+
+/* Changes T's (effective) priority to PRIORITY.  If T is on a
+   ready queue it is moved to the queue for its new priority, so
+   that priority donation to a preempted lock holder takes effect
+   immediately.  If T is waiting, it moves to its new place in
+   the wait queue. */
+void
+thread_update_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (is_thread (t));
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable ();
+	if (t->priority != priority) {
+		if (t->status == THREAD_READY) {
+			ready_remove (t);
+			t->priority = priority;
+			ready_push (t);
+		} else
+			t->priority = priority;
+		if (t->wait_heap != NULL)
+			heap_update (t->wait_heap, t->wait_node);
 	}
+	intr_set_level (old_level);
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void
 thread_set_priority (int new_priority) {
+	enum intr_level old_level;
 
-	if (thread_current() -> init_priority != -1){
-		thread_current()->init_priority = new_priority;
-	}
-	else{
-		thread_current () -> priority = new_priority;
-	}
+	/* The MLFQS computes priorities itself. */
+	if (thread_mlfqs)
+		return;
+
+	/* Donations still hold it up until they are returned. */
+	old_level = intr_disable ();
+	thread_current ()->base_priority = new_priority;
+	refresh_priority ();
+	intr_set_level (old_level);
 	// 현재 쓰레드 priority 변경 후 확인
 	test_max_priority();
 }
@@ -414,31 +683,110 @@ thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	if (nice < NICE_MIN)
+		nice = NICE_MIN;
+	else if (nice > NICE_MAX)
+		nice = NICE_MAX;
+
+	old_level = intr_disable ();
+	curr->nice = nice;
+	if (thread_mlfqs)
+		mlfqs_update_priority (curr);
+	intr_set_level (old_level);
+
+	test_max_priority ();
+}
+
+/* Sets the current thread's stride scheduler tickets to TICKETS
+   and returns the old count, or returns -1 if TICKETS is out of
+   range. */
+int
+thread_set_tickets (int tickets) {
+	struct thread *curr = thread_current ();
+	int old_tickets = curr->tickets;
+
+	if (tickets < TICKETS_MIN || tickets > TICKETS_MAX)
+		return -1;
+	curr->tickets = tickets;
+	return old_tickets;
+}
+
+/* Returns the current thread's stride scheduler tickets. */
+int
+thread_get_tickets (void) {
+	return thread_current ()->tickets;
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int load_avg_100 = fp_round (fp_mul_int (load_avg, 100));
+	intr_set_level (old_level);
+	return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int recent_cpu_100 = fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+	intr_set_level (old_level);
+	return recent_cpu_100;
+}
+
+/* MLFQS updater thread.  Woken by mlfqs_tick() once per second,
+   it decays every thread's recent_cpu and recomputes its
+   priority.  It runs at PRI_MAX and is never preempted, so no
+   other thread can create or destroy threads during the walk;
+   interrupts only need to be off while a single thread is being
+   updated, not for the whole pass. */
+static void
+mlfqs_daemon (void *started_) {
+	struct semaphore *started = started_;
+
+	mlfqs_thread = thread_current ();
+	mlfqs_thread->priority = PRI_MAX;
+	sema_up (started);
+
+	for (;;) {
+		enum intr_level old_level;
+		struct list_elem *e;
+		fixed_t twice_load, coef;
+
+		sema_down (&mlfqs_tick_sema);
+
+		old_level = intr_disable ();
+		twice_load = fp_mul_int (load_avg, 2);
+		intr_set_level (old_level);
+		coef = fp_div (twice_load, fp_add_int (twice_load, 1));
+
+		for (e = list_begin (&all_list); e != list_end (&all_list);
+				e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, all_elem);
+
+			if (is_idle (t) || t == mlfqs_thread)
+				continue;
+
+			old_level = intr_disable ();
+			t->recent_cpu = fp_add_int (fp_mul (coef, t->recent_cpu), t->nice);
+			mlfqs_update_priority (t);
+			intr_set_level (old_level);
+		}
+	}
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -457,14 +805,22 @@ idle (void *idle_started_ UNUSED) {
 	// struct thread *cur = thread_current();
  	// printf("\n:::idle cur tid :::%d %s\n", cur->tid, cur->name);
 
-	idle_thread = thread_current ();
+	thread_current ()->cpu->idle_thread = thread_current ();
 	sema_up (idle_started);
 
 	for (;;) {
+		/* Zero free pages for as long as nothing else is ready. */
+		while (ready_threads () == 0 && palloc_zero_page ())
+			continue;
+
 		/* Let someone else run. */
 		intr_disable ();
 		thread_block ();
 
+		/* Nothing is ready to run, so in -nohz mode the periodic
+		   tick can be stopped until the next sleeper is due. */
+		timer_nohz_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -496,6 +852,8 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
@@ -506,10 +864,17 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = 0;
+	t->tickets = TICKETS_DEFAULT;
 	
 	// Priority donation 관련 자료구조 초기화
-	t-> init_priority = -1;
+	t->base_priority = priority;
 	t-> wait_on_lock = NULL;
+	heap_init (&t->held_locks, lock_more, NULL);
+	t->rw_priority = PRI_MIN - 1;
+	t->wait_heap = NULL;
+	t->rw_read = NULL;
 
 	// exit state 초기화
 	t->exit_status = 0;
@@ -521,24 +886,189 @@ init_thread (struct thread *t, const char *name, int priority) {
 
 	if(!is_thread(t->my_parent)) t->my_parent = initial_thread;
 
-	// fd_table 초기화
-	for (int i=0; i<FD_MAX; i++) t->fd_array[i] = 0;
+	/* A new thread inherits its parent's tickets, and starts at the
+	   current pass so that it does not run ahead of everyone. */
+	if (t->my_parent != NULL && t->my_parent != t)
+		t->tickets = t->my_parent->tickets;
+	t->cpu = t->my_parent != t ? t->my_parent->cpu : &cpus[0];
+	t->pass = t->cpu->global_pass;
+
+	/* Under the MLFQS a new thread inherits its parent's nice and
+	   recent_cpu, and its priority is computed from them. */
+	if (thread_mlfqs) {
+		if (t->my_parent != NULL && t->my_parent != t) {
+			t->nice = t->my_parent->nice;
+			t->recent_cpu = t->my_parent->recent_cpu;
+		}
+		t->priority = mlfqs_priority (t);
+	}
+
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->all_elem);
+	intr_set_level (old_level);
+
+#ifdef USERPROG
+	t->process = NULL;
+	t->stack_slot = -1;
+#endif
 
-	list_init(&t->donations);
 	list_init(&t->child_list);
 	}
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return a thread from this CPU's run queue, unless it is empty,
+   in which case return this CPU's idle thread.  (If the running
+   thread can continue running, then it will be in the run
+   queue.) */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct cpu *c = this_cpu ();
+	struct thread *t;
+
+	spin_lock (&c->rq_lock);
+	t = rq_pop (c);
+	spin_unlock (&c->rq_lock);
+
+	if (t == NULL)
+		return c->idle_thread;
+
+	if (t->pass > c->global_pass)
+		c->global_pass = t->pass;
+	return t;
+}
+
+/* Removes and returns the thread that should run next from C's
+   run queue, or returns a null pointer if it is empty.  C's
+   rq_lock must be held. */
+static struct thread *
+rq_pop (struct cpu *c) {
+	struct thread *t;
+	int priority;
+
+	ASSERT (spin_is_locked (&c->rq_lock));
+
+	if (c->ready_cnt == 0)
+		return NULL;
+	c->ready_cnt--;
+
+	if (thread_stride)
+		return heap_entry (heap_pop (&c->stride_heap), struct thread,
+				stride_elem);
+
+	priority = 63 - __builtin_clzll (c->ready_mask);
+	t = list_entry (list_pop_front (&c->ready_queues[priority]),
+			struct thread, elem);
+	if (list_empty (&c->ready_queues[priority]))
+		c->ready_mask &= ~(1ULL << priority);
+	return t;
+}
+
+/* Appends T to the tail of the run queue for its priority on its
+   CPU.  Interrupts must be off. */
+static void
+ready_push (struct thread *t) {
+	struct cpu *c = t->cpu;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&c->rq_lock);
+	if (thread_stride) {
+		if (t->pass < c->global_pass)
+			t->pass = c->global_pass;
+		heap_push (&c->stride_heap, &t->stride_elem);
+	} else {
+		list_push_back (&c->ready_queues[t->priority], &t->elem);
+		c->ready_mask |= 1ULL << t->priority;
+	}
+	c->ready_cnt++;
+	spin_unlock (&c->rq_lock);
+}
+
+/* Removes T from the run queue it is on.  Interrupts must be
+   off. */
+static void
+ready_remove (struct thread *t) {
+	struct cpu *c = t->cpu;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	spin_lock (&c->rq_lock);
+	if (thread_stride)
+		heap_remove (&c->stride_heap, &t->stride_elem);
+	else {
+		list_remove (&t->elem);
+		if (list_empty (&c->ready_queues[t->priority]))
+			c->ready_mask &= ~(1ULL << t->priority);
+	}
+	c->ready_cnt--;
+	spin_unlock (&c->rq_lock);
+}
+
+/* Returns the highest priority among the threads ready on this
+   CPU, or -1 if there are none. */
+static int
+ready_max_priority (void) {
+	struct cpu *c = this_cpu ();
+
+	if (c->ready_cnt == 0)
+		return -1;
+	if (thread_stride)
+		return PRI_MIN;
+	return 63 - __builtin_clzll (c->ready_mask);
+}
+
+/* Returns the number of ready threads on all CPUs. */
+static int
+ready_threads (void) {
+	int cnt = 0;
+	int i;
+
+	for (i = 0; i < cpu_cnt; i++)
+		cnt += cpus[i].ready_cnt;
+	return cnt;
+}
+
+/* Returns the CPU that the running thread is on. */
+struct cpu *
+this_cpu (void) {
+	return running_thread ()->cpu;
+}
+
+/* Returns true if T is the idle thread of its CPU. */
+static bool
+is_idle (const struct thread *t) {
+	return t == t->cpu->idle_thread;
+}
+
+/* Initializes C as CPU number ID, with empty run queues. */
+static void
+init_cpu (struct cpu *c, int id) {
+	int i;
+
+	c->id = id;
+	c->idle_thread = NULL;
+	c->thread_ticks = 0;
+	spin_init (&c->rq_lock);
+	for (i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&c->ready_queues[i]);
+	c->ready_mask = 0;
+	c->ready_cnt = 0;
+	heap_init (&c->stride_heap, pass_less, NULL);
+	c->global_pass = 0;
+}
+
+/* Orders threads by pass value, then by tid, for the stride
+   scheduler. */
+static bool
+pass_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, stride_elem);
+	const struct thread *b = heap_entry (b_, struct thread, stride_elem);
+
+	if (a->pass != b->pass)
+		return a->pass < b->pass;
+	return a->tid < b->tid;
 }
 
 /* Use iretq to launch the thread */
@@ -581,10 +1111,23 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
+	struct thread *curr = running_thread ();
+	uint64_t tf_cur = (uint64_t) &curr->tf;
 	uint64_t tf = (uint64_t) &th->tf;
+	uint64_t next_rsp = th->switch_rsp;
 	ASSERT (intr_get_level () == INTR_OFF);
 
+	/* Every thread that gets here is running in kernel mode, so
+	 * only the callee-saved registers and the stack pointer have to
+	 * survive the switch.  A thread that has never run, or that was
+	 * switched out with a full save, has switch_rsp == 0 and is
+	 * resumed by do_iret() from its intr_frame instead. */
+	th->switch_rsp = 0;
+	if (thread_fast_switch) {
+		context_switch (&curr->switch_rsp, next_rsp, &th->tf);
+		return;
+	}
+
 	/* The main switching logic.
 	 * We first restore the whole execution context into the intr_frame
 	 * and then switching to the next thread by calling do_iret.
@@ -637,13 +1180,53 @@ thread_launch (struct thread *th) {
 			"mov %%rbx, 16(%%rax)\n" // eflags
 			"mov %%rsp, 24(%%rax)\n" // rsp
 			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
+			"mov %%rcx, %%rsi\n"
+			"mov %%rdx, %%rdi\n"
+			"call context_restore\n"
 			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
+			: : "g"(tf_cur), "g" (tf), "d" (next_rsp) : "memory"
 			);
 }
 
+/* Returns a page for a new thread, from the thread cache if it
+   has one, or else from the page allocator.  The page is not
+   zeroed: init_thread() clears the struct thread, and the rest
+   of the page is stack. */
+static struct thread *
+alloc_thread_page (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (!list_empty (&thread_cache)) {
+		t = list_entry (list_pop_front (&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+		cache_hits++;
+	} else
+		cache_misses++;
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Releases the page of dead thread T, keeping it in the thread
+   cache unless the cache is at its high watermark.  Interrupts
+   must be off. */
+static void
+free_thread_page (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_cache_cnt < thread_cache_max) {
+		/* Stale pointers to T must not pass is_thread(). */
+		t->magic = 0;
+		list_push_front (&thread_cache, &t->elem);
+		thread_cache_cnt++;
+	} else
+		palloc_free_page (t);
+}
+
 /* Schedules a new process. At entry, interrupts must be off.
  * This function modify current thread's status to status and then
  * finds another thread to run and switches to it.
@@ -655,7 +1238,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		free_thread_page (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -673,9 +1256,21 @@ schedule (void) {
 	ASSERT (is_thread (next));
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
+	if (!is_idle (next))
+		next->usage.ready_ticks += timer_ticks () - next->ready_since;
+	if (curr != next) {
+		/* A thread that is switched out while still runnable was
+		   preempted; one that blocked gave up the CPU itself. */
+		if (curr->status == THREAD_READY)
+			curr->usage.invol_switches++;
+		else if (curr->status == THREAD_BLOCKED)
+			curr->usage.vol_switches++;
+		thread_trace (TRACE_SWITCH_OUT, curr, curr->status);
+		thread_trace (TRACE_SWITCH_IN, next, curr->tid);
+	}
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	next->cpu->thread_ticks = 0;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -714,53 +1309,132 @@ allocate_tid (void) {
 	return tid;
 }
 
-void thread_sleep(void) {
-	
-	struct thread *curr = thread_current();
-	// curr->wakeup_tick = ticks + timer_ticks();
-	ASSERT(curr->status == THREAD_RUNNING);
+/* Puts the current thread to sleep until the tick set by
+   thread_osiete(). */
+void
+thread_sleep (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
-	enum intr_level old_level = intr_disable ();
-	list_push_back(&sleep_list, &(curr->elem));
-	thread_block();
+	ASSERT (curr->status == THREAD_RUNNING);
+	ASSERT (!is_idle (curr));
+
+	old_level = intr_disable ();
+	heap_push (&sleep_heap, &curr->sleep_elem);
+	update_next_tick_to_awake (curr->wakeup_tick);
+	thread_block ();
 	intr_set_level (old_level);
 }
 
-void thread_osiete(int64_t ticks) {
-	struct thread *curr = thread_current();
-	curr->wakeup_tick = timer_ticks() + ticks;
+/* Takes T, whose wait has timed out, off the wait queue it is
+   sorted in by priority, if any, so that nobody can wake it up a
+   second time. */
+static void
+cancel_wait (struct thread *t) {
+	if (t->wait_heap != NULL) {
+		heap_remove (t->wait_heap, t->wait_node);
+		t->wait_heap = NULL;
+	}
 }
 
-void thread_awake(int64_t ticks) {
-	if(list_empty(&sleep_list)) return;
-	
-	struct list_elem *curr_elem;
-	struct thread *cthread;
+/* Blocks the current thread like thread_block(), but if nobody
+   unblocks it by tick DEADLINE, the timer interrupt does.  A
+   DEADLINE of INT64_MAX never passes.  Returns true if the
+   deadline passed, false if another thread unblocked us.
 
-	curr_elem = list_begin(&sleep_list);  
+   This is the one wakeup source for every bounded wait: a
+   thread that times out is taken off its wait queue (its
+   `wait_heap') in the same step, so the timeout and a wakeup
+   from the queue can never both happen.
 
-	while(curr_elem != list_end(&sleep_list)){
-		
-		cthread = list_entry(curr_elem, struct thread, elem);
+   Must be called with interrupts turned off. */
+bool
+thread_block_until (int64_t deadline) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (!intr_context ());
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!is_idle (curr));
 
-		if(ticks >= cthread->wakeup_tick) {
-			curr_elem = list_remove(curr_elem); // list_remove는 제거되는elem -> next 를 반환 
-			thread_unblock(cthread);
+	curr->timed_out = false;
+	if (deadline != INT64_MAX) {
+		if (deadline <= timer_ticks ()) {
+			cancel_wait (curr);
+			return curr->timed_out = true;
 		}
-		else {
-			curr_elem = list_next(curr_elem);
+		curr->wakeup_tick = deadline;
+		curr->timed_wait = true;
+		heap_push (&sleep_heap, &curr->sleep_elem);
+		update_next_tick_to_awake (deadline);
+	}
+	thread_block ();
+	return curr->timed_out;
+}
+
+/* Sets the tick at which the current thread should wake up,
+   TICKS from now. */
+void
+thread_osiete (int64_t ticks) {
+	struct thread *curr = thread_current ();
+	curr->wakeup_tick = timer_ticks () + ticks;
+}
+
+/* Wakes up every sleeping thread whose wakeup tick is at or
+   before TICKS.  Called from the timer interrupt, so its cost is
+   O(k log n) for k expiring sleepers out of n. */
+void
+thread_awake (int64_t ticks) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (!heap_empty (&sleep_heap)) {
+		struct thread *t = heap_entry (heap_top (&sleep_heap),
+				struct thread, sleep_elem);
+		if (t->wakeup_tick > ticks)
+			break;
+		heap_pop (&sleep_heap);
+		if (t->timed_wait) {
+			t->timed_wait = false;
+			t->timed_out = true;
+			cancel_wait (t);
 		}
+		thread_trace (TRACE_WAKEUP, t, t->wakeup_tick);
+		thread_unblock (t);
 	}
-	// update_next_tick_to_awake(next_tick);
+
+	next_tick = heap_empty (&sleep_heap) ? INT64_MAX
+		: heap_entry (heap_top (&sleep_heap), struct thread,
+				sleep_elem)->wakeup_tick;
+
+	/* A higher-priority sleeper may have just woken up. */
+	test_max_priority ();
 }
 
-// void update_next_tick_to_awake(int64_t ticks) {
+/* Lowers the next wakeup tick to TICKS if it is earlier. */
+void
+update_next_tick_to_awake (int64_t ticks) {
+	if (ticks < next_tick)
+		next_tick = ticks;
+}
 
-// }
+/* Returns the earliest tick at which a sleeping thread must be
+   woken up, or INT64_MAX if no thread is sleeping. */
+int64_t
+get_next_tick_to_awake (void) {
+	return next_tick;
+}
 
-// int64_t get_next_tick_to_awake(void) {
-	
-// }
+/* Orders sleeping threads by wakeup tick, then by tid so that
+   threads due on the same tick wake up in creation order. */
+static bool
+wakeup_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+	const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
+
+	if (a->wakeup_tick != b->wakeup_tick)
+		return a->wakeup_tick < b->wakeup_tick;
+	return a->tid < b->tid;
+}
 
 int destruction_req_check (tid_t child_tid) {
 	struct list_elem *list_elem;
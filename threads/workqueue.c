@@ -0,0 +1,375 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of worker threads.  More than one lets work that
+   sleeps on I/O overlap with work that does not. */
+#define WORKER_CNT 2
+
+/* Thread priority at which each level of work runs. */
+static const int work_thread_priority[WORK_PRI_CNT] = {
+	PRI_DEFAULT + 1,            /* WORK_HIGH. */
+	PRI_DEFAULT,                /* WORK_NORMAL. */
+	PRI_DEFAULT - 1,            /* WORK_LOW. */
+};
+
+/* Protects everything below up to FLUSH_LOCK.  Taken with
+   interrupts off, since interrupt handlers queue work. */
+static struct spinlock wq_lock;
+
+/* Queued work, one FIFO list per priority. */
+static struct list run_queues[WORK_PRI_CNT];
+
+/* Delayed work, earliest due on top, and the tick at which the
+   top item is due, or INT64_MAX if there is none.  The timer
+   interrupt reads NEXT_DUE without the lock. */
+static struct heap delayed;
+static int64_t next_due = INT64_MAX;
+
+/* Item that each worker is running, if any. */
+static struct work *running[WORKER_CNT];
+
+/* Upped once per queued item.  Workers sleep on it. */
+static struct semaphore work_avail;
+
+/* Workers broadcast FLUSH_DONE after every item they run, for
+   the benefit of threads waiting in the flush functions. */
+static struct lock flush_lock;
+static struct condition flush_done;
+
+static void worker_thread (void *slot_);
+static void enqueue (struct work *);
+static bool delayed_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static void update_next_due (void);
+static bool is_running (const struct work *);
+static bool is_busy (void);
+
+/* Initializes the work queues and starts the worker threads.
+   The thread system must already be running. */
+void
+workqueue_init (void) {
+	int i;
+
+	spin_init (&wq_lock);
+	for (i = 0; i < WORK_PRI_CNT; i++)
+		list_init (&run_queues[i]);
+	heap_init (&delayed, delayed_less, NULL);
+	sema_init (&work_avail, 0);
+	lock_init (&flush_lock);
+	cond_init (&flush_done);
+
+	for (i = 0; i < WORKER_CNT; i++) {
+		char name[16];
+
+		snprintf (name, sizeof name, "kworker/%d", i);
+		if (thread_create (name, PRI_DEFAULT, worker_thread,
+					(void *) (intptr_t) i) == TID_ERROR)
+			PANIC ("cannot start worker thread");
+	}
+}
+
+/* Called by the timer interrupt handler at tick NOW.  Moves the
+   delayed work that has come due to its run queue. */
+void
+workqueue_tick (int64_t now) {
+	int cnt = 0;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (now < next_due)
+		return;
+
+	spin_lock (&wq_lock);
+	while (!heap_empty (&delayed)) {
+		struct work *w = heap_entry (heap_top (&delayed),
+				struct work, delay_elem);
+		if (w->due > now)
+			break;
+		heap_pop (&delayed);
+		enqueue (w);
+		cnt++;
+	}
+	update_next_due ();
+	spin_unlock (&wq_lock);
+
+	while (cnt-- > 0)
+		sema_up (&work_avail);
+}
+
+/* Returns the tick at which the earliest delayed work is due,
+   or INT64_MAX if there is none, so that a tickless idle CPU
+   wakes up for it. */
+int64_t
+workqueue_next_due (void) {
+	return next_due;
+}
+
+/* Waits until every run queue is empty and no worker is running
+   anything, including work queued while waiting.  Delayed work
+   that has not come due is not waited for. */
+void
+workqueue_flush (void) {
+	ASSERT (!intr_context ());
+
+	lock_acquire (&flush_lock);
+	while (is_busy ())
+		cond_wait (&flush_done, &flush_lock);
+	lock_release (&flush_lock);
+}
+
+/* Initializes W to call FUNC with AUX at priority PRIORITY. */
+void
+work_init (struct work *w, work_func *func, void *aux,
+		enum work_priority priority) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+	ASSERT (priority >= 0 && priority < WORK_PRI_CNT);
+
+	w->func = func;
+	w->aux = aux;
+	w->priority = priority;
+	w->state = WORK_IDLE;
+	w->due = 0;
+}
+
+/* Queues W to be run by a worker as soon as one is free.
+   Returns true if W was queued, false if it was already
+   pending.  May be called from an interrupt handler. */
+bool
+work_queue (struct work *w) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	old_level = spin_lock_irqsave (&wq_lock);
+	if (w->state == WORK_IDLE) {
+		enqueue (w);
+		queued = true;
+	}
+	spin_unlock_irqrestore (&wq_lock, old_level);
+
+	if (queued)
+		sema_up (&work_avail);
+	return queued;
+}
+
+/* Queues W to be run once TICKS timer ticks have passed, or at
+   once if TICKS is not positive.  Returns true if W was queued,
+   false if it was already pending.  May be called from an
+   interrupt handler. */
+bool
+work_queue_delayed (struct work *w, int64_t ticks) {
+	enum intr_level old_level;
+	int64_t due;
+	bool queued = false;
+
+	if (ticks <= 0)
+		return work_queue (w);
+
+	due = timer_ticks () + ticks;
+	old_level = spin_lock_irqsave (&wq_lock);
+	if (w->state == WORK_IDLE) {
+		w->state = WORK_DELAYED;
+		w->due = due;
+		heap_push (&delayed, &w->delay_elem);
+		update_next_due ();
+		queued = true;
+	}
+	spin_unlock_irqrestore (&wq_lock, old_level);
+
+	return queued;
+}
+
+/* Returns true if W is delayed or queued. */
+bool
+work_pending (const struct work *w) {
+	return w->state != WORK_IDLE;
+}
+
+/* Takes W off its queue if it is pending.  Returns true if it
+   was pending.  Does not wait for a worker that is already
+   running W; see work_cancel_sync() for that.  May be called
+   from an interrupt handler. */
+bool
+work_cancel (struct work *w) {
+	enum intr_level old_level;
+	bool pending;
+
+	old_level = spin_lock_irqsave (&wq_lock);
+	pending = w->state != WORK_IDLE;
+	if (w->state == WORK_DELAYED) {
+		heap_remove (&delayed, &w->delay_elem);
+		update_next_due ();
+	} else if (w->state == WORK_QUEUED)
+		list_remove (&w->elem);
+	w->state = WORK_IDLE;
+	spin_unlock_irqrestore (&wq_lock, old_level);
+
+	/* A worker woken for W finds nothing to do and goes back
+	   to sleep. */
+	return pending;
+}
+
+/* Waits until W is neither queued nor running.  If W is
+   delayed, it is queued at once rather than waited for; if it
+   then delays itself again, that is not waited for. */
+void
+work_flush (struct work *w) {
+	enum intr_level old_level;
+	bool busy, kick = false;
+
+	ASSERT (!intr_context ());
+
+	lock_acquire (&flush_lock);
+	old_level = spin_lock_irqsave (&wq_lock);
+	if (w->state == WORK_DELAYED) {
+		heap_remove (&delayed, &w->delay_elem);
+		update_next_due ();
+		enqueue (w);
+		kick = true;
+	}
+	spin_unlock_irqrestore (&wq_lock, old_level);
+	if (kick)
+		sema_up (&work_avail);
+
+	for (;;) {
+		old_level = spin_lock_irqsave (&wq_lock);
+		busy = w->state == WORK_QUEUED || is_running (w);
+		spin_unlock_irqrestore (&wq_lock, old_level);
+		if (!busy)
+			break;
+		cond_wait (&flush_done, &flush_lock);
+	}
+	lock_release (&flush_lock);
+}
+
+/* Cancels W and waits for any worker running it to finish, so
+   that afterward W is idle and its function is not running,
+   even if it queues itself again.  Returns true if W was
+   pending. */
+bool
+work_cancel_sync (struct work *w) {
+	enum intr_level old_level;
+	bool pending = false;
+	bool busy;
+
+	ASSERT (!intr_context ());
+
+	lock_acquire (&flush_lock);
+	do {
+		if (work_cancel (w))
+			pending = true;
+
+		old_level = spin_lock_irqsave (&wq_lock);
+		busy = is_running (w);
+		spin_unlock_irqrestore (&wq_lock, old_level);
+		if (busy)
+			cond_wait (&flush_done, &flush_lock);
+	} while (busy || work_pending (w));
+	lock_release (&flush_lock);
+
+	return pending;
+}
+
+/* Worker thread.  SLOT_ is its index in RUNNING. */
+static void
+worker_thread (void *slot_) {
+	int slot = (intptr_t) slot_;
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *w = NULL;
+		work_func *func = NULL;
+		void *aux = NULL;
+		int pri;
+
+		sema_down (&work_avail);
+
+		old_level = spin_lock_irqsave (&wq_lock);
+		for (pri = 0; pri < WORK_PRI_CNT; pri++)
+			if (!list_empty (&run_queues[pri])) {
+				w = list_entry (list_pop_front (&run_queues[pri]),
+						struct work, elem);
+				w->state = WORK_IDLE;
+				running[slot] = w;
+				func = w->func;
+				aux = w->aux;
+				break;
+			}
+		spin_unlock_irqrestore (&wq_lock, old_level);
+		if (w == NULL)
+			continue;
+
+		/* W may be freed or queued again by FUNC, so it is not
+		   touched after the call. */
+		thread_set_priority (work_thread_priority[pri]);
+		func (aux);
+
+		old_level = spin_lock_irqsave (&wq_lock);
+		running[slot] = NULL;
+		spin_unlock_irqrestore (&wq_lock, old_level);
+
+		lock_acquire (&flush_lock);
+		cond_broadcast (&flush_done, &flush_lock);
+		lock_release (&flush_lock);
+	}
+}
+
+/* Appends W to its run queue.  WQ_LOCK must be held.  The
+   caller must up WORK_AVAIL once it has released the lock. */
+static void
+enqueue (struct work *w) {
+	w->state = WORK_QUEUED;
+	list_push_back (&run_queues[w->priority], &w->elem);
+}
+
+/* Orders delayed work by due tick, earliest first. */
+static bool
+delayed_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct work *a = heap_entry (a_, struct work, delay_elem);
+	const struct work *b = heap_entry (b_, struct work, delay_elem);
+
+	return a->due < b->due;
+}
+
+/* Recomputes NEXT_DUE.  WQ_LOCK must be held. */
+static void
+update_next_due (void) {
+	next_due = heap_empty (&delayed) ? INT64_MAX
+		: heap_entry (heap_top (&delayed), struct work, delay_elem)->due;
+}
+
+/* Returns true if a worker is running W.  WQ_LOCK must be
+   held. */
+static bool
+is_running (const struct work *w) {
+	int i;
+
+	for (i = 0; i < WORKER_CNT; i++)
+		if (running[i] == w)
+			return true;
+	return false;
+}
+
+/* Returns true if any work is queued or running. */
+static bool
+is_busy (void) {
+	enum intr_level old_level;
+	bool busy = false;
+	int i;
+
+	old_level = spin_lock_irqsave (&wq_lock);
+	for (i = 0; i < WORK_PRI_CNT && !busy; i++)
+		busy = !list_empty (&run_queues[i]);
+	for (i = 0; i < WORKER_CNT && !busy; i++)
+		busy = running[i] != NULL;
+	spin_unlock_irqrestore (&wq_lock, old_level);
+
+	return busy;
+}
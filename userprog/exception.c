@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "userprog/process.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -86,7 +87,7 @@ kill (struct intr_frame *f) {
 			printf ("%s: dying due to interrupt %#04llx (%s).\n",
 					thread_name (), f->vec_no, intr_name (f->vec_no));
 			intr_dump_frame (f);
-			thread_exit ();
+			process_terminate (-1);
 
 		case SEL_KCSEG:
 			/* Kernel's code segment, which indicates a kernel bug.
@@ -149,8 +150,7 @@ page_fault (struct intr_frame *f) {
 #endif
 	if(user) {
 		// printf("user fault\n");
-		thread_current()->exit_status = -1;
-		thread_exit();
+		process_terminate (-1);
 	}
 
 	/* Count page faults. */
@@ -0,0 +1,256 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <heap.h>
+#include <list.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "userprog/process.h"
+
+/* Futexes.
+
+   A futex is an ordinary int in user memory.  futex_wait() puts
+   the calling thread to sleep if the int still holds the value
+   that the caller expects, and futex_wake() wakes up threads
+   sleeping on it.  The user library builds its locks on top of
+   these (see lib/user/synch.c) so that a thread only enters the
+   kernel when it actually has to wait or to wake somebody up.
+
+   Threads waiting on the same address share a wait queue, found
+   through a hash table keyed by address space and user address.
+   A queue exists while some thread that called futex_wait() on
+   its address has not yet returned; the last one to return
+   frees it.  As with
+   semaphores, waiters are woken in priority order, first come
+   first served among equal priorities, and a waiter whose
+   priority changes (say, through donation) is re-sorted in its
+   queue.
+
+   Each hash bucket has a spin lock.  Checking the int and
+   queueing the caller happen under it, so a futex_wake() that
+   follows a change to the int cannot slip in between the check
+   and the sleep. */
+
+#define FUTEX_BUCKETS 64        /* Number of hash buckets. */
+
+/* Threads waiting on one user address. */
+struct futex_queue {
+	struct list_elem elem;      /* Element in a hash bucket. */
+	uint64_t *pml4;             /* Address space. */
+	int *uaddr;                 /* User address. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
+	unsigned next_seq;          /* Keeps equal-priority waiters in FIFO order. */
+	int users;                  /* Threads in futex_wait() on it. */
+};
+
+/* A hash bucket. */
+struct futex_bucket {
+	struct spinlock lock;       /* Protects QUEUES and the queues in it. */
+	struct list queues;         /* List of struct futex_queue. */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+static struct futex_bucket *bucket_of (uint64_t *pml4, int *uaddr);
+static struct futex_queue *find_queue (struct futex_bucket *,
+		uint64_t *pml4, int *uaddr);
+static bool read_word (uint64_t *pml4, int *uaddr, int *value);
+
+/* Initializes the futex hash table. */
+void
+futex_init (void) {
+	size_t i;
+
+	for (i = 0; i < FUTEX_BUCKETS; i++) {
+		spin_init (&buckets[i].lock);
+		list_init (&buckets[i].queues);
+	}
+}
+
+/* If the int at user address UADDR still holds EXPECTED, sleeps
+   until futex_wake() is called on UADDR or, if TIMEOUT is not
+   negative, until TIMEOUT timer ticks have passed.  Returns 0 if
+   woken up by futex_wake(), 1 if the timeout expired, or -1 if
+   *UADDR did not hold EXPECTED.
+
+   UADDR must be a valid, int-aligned user address. */
+int
+futex_wait (int *uaddr, int expected, int64_t timeout) {
+	struct thread *cur = thread_current ();
+	struct futex_bucket *b = bucket_of (cur->pml4, uaddr);
+	struct futex_queue *q, *spare;
+	enum intr_level old_level;
+	int64_t deadline;
+	int value;
+	int result;
+
+	deadline = timeout < 0 ? INT64_MAX : timer_ticks () + timeout;
+
+	/* Allocate a queue up front, since malloc() may sleep. */
+	spare = malloc (sizeof *spare);
+	if (spare == NULL)
+		return -1;
+
+	for (;;) {
+		old_level = spin_lock_irqsave (&b->lock);
+		if (read_word (cur->pml4, uaddr, &value))
+			break;
+
+		/* The page is not present.  Fault it in with interrupts on
+		   and look again, since it may be evicted in between. */
+		spin_unlock_irqrestore (&b->lock, old_level);
+		(void) *(volatile int *) uaddr;
+	}
+
+	/* Don't go to sleep in a process that is exiting: futex_wake_all()
+	   may already have swept this bucket. */
+	if (value != expected || process_exiting ()) {
+		spin_unlock_irqrestore (&b->lock, old_level);
+		free (spare);
+		return -1;
+	}
+
+	q = find_queue (b, cur->pml4, uaddr);
+	if (q == NULL) {
+		q = spare;
+		spare = NULL;
+		q->pml4 = cur->pml4;
+		q->uaddr = uaddr;
+		heap_init (&q->waiters, waiter_more, NULL);
+		q->next_seq = 0;
+		q->users = 0;
+		list_push_back (&b->queues, &q->elem);
+	}
+	q->users++;
+	cur->wait_seq = q->next_seq++;
+	heap_push (&q->waiters, &cur->wait_elem);
+	cur->wait_heap = &q->waiters;
+	cur->wait_node = &cur->wait_elem;
+	spin_unlock (&b->lock);
+
+	/* Either futex_wake() or the timeout takes us off Q. */
+	result = thread_block_until (deadline) ? 1 : 0;
+
+	spin_lock (&b->lock);
+	if (--q->users == 0) {
+		ASSERT (heap_empty (&q->waiters));
+		list_remove (&q->elem);
+		ASSERT (spare == NULL);
+		spare = q;
+	}
+	spin_unlock (&b->lock);
+	intr_set_level (old_level);
+
+	free (spare);
+	return result;
+}
+
+/* Wakes up at most CNT of the threads waiting on user address
+   UADDR, highest priority first, and returns the number woken. */
+int
+futex_wake (int *uaddr, int cnt) {
+	struct thread *cur = thread_current ();
+	struct futex_bucket *b = bucket_of (cur->pml4, uaddr);
+	struct futex_queue *q;
+	enum intr_level old_level;
+	int woken = 0;
+
+	old_level = spin_lock_irqsave (&b->lock);
+	q = find_queue (b, cur->pml4, uaddr);
+	if (q != NULL) {
+		while (woken < cnt && !heap_empty (&q->waiters)) {
+			struct thread *t = heap_entry (heap_pop (&q->waiters),
+					struct thread, wait_elem);
+
+			t->wait_heap = NULL;
+			thread_unblock (t);
+			woken++;
+		}
+	}
+	spin_unlock (&b->lock);
+
+	if (woken > 0)
+		test_max_priority ();
+	intr_set_level (old_level);
+
+	return woken;
+}
+
+/* Wakes up every thread waiting on any futex in address space
+   PML4, so that the threads of an exiting process notice. */
+void
+futex_wake_all (uint64_t *pml4) {
+	enum intr_level old_level;
+	bool woken = false;
+	size_t i;
+
+	old_level = intr_disable ();
+	for (i = 0; i < FUTEX_BUCKETS; i++) {
+		struct futex_bucket *b = &buckets[i];
+		struct list_elem *e;
+
+		spin_lock (&b->lock);
+		for (e = list_begin (&b->queues); e != list_end (&b->queues);
+				e = list_next (e)) {
+			struct futex_queue *q = list_entry (e, struct futex_queue, elem);
+
+			if (q->pml4 != pml4)
+				continue;
+			while (!heap_empty (&q->waiters)) {
+				struct thread *t = heap_entry (heap_pop (&q->waiters),
+						struct thread, wait_elem);
+
+				t->wait_heap = NULL;
+				thread_unblock (t);
+				woken = true;
+			}
+		}
+		spin_unlock (&b->lock);
+	}
+
+	if (woken)
+		test_max_priority ();
+	intr_set_level (old_level);
+}
+
+/* Returns the bucket that UADDR in address space PML4 hashes to. */
+static struct futex_bucket *
+bucket_of (uint64_t *pml4, int *uaddr) {
+	uintptr_t key = (uintptr_t) uaddr ^ ((uintptr_t) pml4 << 7);
+
+	return &buckets[hash_bytes (&key, sizeof key) % FUTEX_BUCKETS];
+}
+
+/* Returns the queue for UADDR in address space PML4 in bucket B,
+   or a null pointer if nobody waits on UADDR.  B's lock must be
+   held. */
+static struct futex_queue *
+find_queue (struct futex_bucket *b, uint64_t *pml4, int *uaddr) {
+	struct list_elem *e;
+
+	for (e = list_begin (&b->queues); e != list_end (&b->queues);
+			e = list_next (e)) {
+		struct futex_queue *q = list_entry (e, struct futex_queue, elem);
+		if (q->pml4 == pml4 && q->uaddr == uaddr)
+			return q;
+	}
+	return NULL;
+}
+
+/* Stores the int at user address UADDR in address space PML4
+   into *VALUE and returns true, or returns false without
+   touching it if its page is not present.  Never faults, so it
+   is safe with interrupts off. */
+static bool
+read_word (uint64_t *pml4, int *uaddr, int *value) {
+	int *kaddr = pml4_get_page (pml4, uaddr);
+
+	if (kaddr == NULL)
+		return false;
+	*value = *kaddr;
+	return true;
+}
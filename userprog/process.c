@@ -13,7 +13,9 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -24,6 +26,7 @@
 #include "lib/user/syscall.h"
 
 #include "lib/stdio.h"	// hex_dump()
+#include "userprog/futex.h"
 
 #ifdef VM
 #include "vm/vm.h"
@@ -33,6 +36,9 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void start_thread (void *);
+static void *setup_thread_stack (int slot);
+static int wait_child (tid_t, bool is_thread);
 
 static struct passing_args {
 	struct intr_frame *parent_f;
@@ -40,11 +46,39 @@ static struct passing_args {
 	struct semaphore *birth_sema;
 };
 
+/* Arguments that thread_spawn() passes to start_thread(). */
+struct spawn_args {
+	struct intr_frame if_;      /* User context to start in. */
+	struct process *process;    /* Process to join. */
+	uint64_t *pml4;             /* Its address space. */
+	int stack_slot;             /* Stack slot reserved for the thread. */
+};
+
 /* General process initializer for initd and other process. */
 /* 일반적인 프로세서 생성자 */
-static void
+/* Creates a process whose main thread is the current thread.
+   Returns false if out of memory. */
+static bool
 process_init (void) {
 	struct thread *current = thread_current ();
+	struct process *proc = malloc (sizeof *proc);
+
+	if (proc == NULL)
+		return false;
+	proc->main = current;
+	lock_init (&proc->lock);
+	cond_init (&proc->threads_done);
+	proc->thread_cnt = 1;
+	proc->exiting = false;
+	proc->exit_status = 0;
+	proc->stack_slots = 0;
+	memset (proc->fd_array, 0, sizeof proc->fd_array);
+#ifdef VM
+	supplemental_page_table_init (&proc->spt);
+	work_init (&proc->writeback, mmap_writeback, proc, WORK_NORMAL);
+#endif
+	current->process = proc;
+	return true;
 }
 
 /* Starts the first userland program, called "initd", loaded from FILE_NAME.
@@ -80,11 +114,8 @@ process_create_initd (const char *file_name) {
 /* 첫 유저 프로세스를 실행시키는 thread routine func */
 static void
 initd (void *f_name) {
-#ifdef VM
-	supplemental_page_table_init (&thread_current ()->spt);
-#endif
-
-	process_init ();
+	if (!process_init ())
+		PANIC("Fail to launch initd\n");
 
 	if (process_exec (f_name) < 0)
 		PANIC("Fail to launch initd\n");
@@ -208,11 +239,13 @@ __do_fork (void *aux) {
 	current->pml4 = pml4_create(); 
 	if (current->pml4 == NULL)
 		goto error;
+	if (!process_init ())
+		goto error;
 
 	process_activate (current);											// process 를 실행가능하도록 바꿔줌
 #ifdef VM
-	supplemental_page_table_init (&current->spt);
-	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
+	if (!supplemental_page_table_copy (&current->process->spt,
+				&parent->process->spt))
 		goto error;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
@@ -226,15 +259,16 @@ __do_fork (void *aux) {
 	 * TODO:       the resources of parent.*/
 
 	for (int i = FD_MIN; i < FD_MAX; i++) {										// 부모의 fd_array 를 그대로 가져오기
-		if (parent->fd_array[i]) {
-			current->fd_array[i] = file_duplicate (parent->fd_array[i]);
-		} else {
-			current->fd_array[i] = NULL;
+		if (parent->process->fd_array[i]) {
+			current->process->fd_array[i] =
+				file_duplicate (parent->process->fd_array[i]);
 		}
 	}
-	current->current_file = file_duplicate(parent->current_file);				// 부모가 실행 중인 file : exec로 실행된 fd가 없는 현재 실행중인 *file
+	/* The parent may be a thread_spawn()ed thread; the running
+	   executable is kept by the main thread. */
+	current->current_file =
+		file_duplicate(parent->process->main->current_file);				// 부모가 실행 중인 file : exec로 실행된 fd가 없는 현재 실행중인 *file
 
-	process_init ();
 	// memcpy(&current->tf, &if_, sizeof (struct intr_frame));						// 이 정보가 그대로 쓰일 일은 없긴 함. 단지 부모랑 완전 똑같이 만들어주기위함
 	
 	/* Finally, switch to the newly created process. */
@@ -267,6 +301,18 @@ process_exec (void *f_name) {
 	/* 스레드 구조에서 intr_frame을 사용할 수 없습니다.
 	왜냐하면 스레드를 rescheduled할 때 이것은 스레드에게 줄 실행 정보를 저장합니다.*/
 	struct intr_frame _if;
+	struct process *proc = thread_current ()->process;
+	bool alone;
+
+	/* Only a process with a single thread may exec. */
+	lock_acquire (&proc->lock);
+	alone = proc->thread_cnt == 1;
+	lock_release (&proc->lock);
+	if (!alone) {
+		palloc_free_page (file_name);
+		return -1;
+	}
+
 	_if.ds = _if.es = _if.ss = SEL_UDSEG; // User data Selector
 	_if.cs = SEL_UCSEG; // User code selector
 	_if.eflags = FLAG_IF | FLAG_MBS; // Flags
@@ -275,14 +321,14 @@ process_exec (void *f_name) {
 	process_cleanup ();
 	
 	#ifdef VM
-	supplemental_page_table_init(&thread_current()->spt);
+	supplemental_page_table_init(&proc->spt);
 	#endif
 
 	/* And then load the binary */
 	// file_close(thread_current()->current_file);
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	success = load (file_name, &_if);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 
 
 	/* If load failed, quit. */
@@ -314,6 +360,109 @@ TID가 유효하지 않거나 호출 프로세스의 자식이 아니거나 주
 */
 int
 process_wait (tid_t child_tid) {
+	return wait_child (child_tid, false);
+}
+
+/* Starts a new thread in the current process that shares its
+   address space and file table.  The thread runs ENTRY (FUNC,
+   AUX) in user mode, on a stack of its own.  Returns the new
+   thread's tid, or TID_ERROR if it cannot be created. */
+tid_t
+process_spawn (void *entry, void *func, void *aux) {
+	struct thread *curr = thread_current ();
+	struct process *proc = curr->process;
+	struct spawn_args *sa;
+	struct child_info *info;
+	uint8_t *stack_top;
+	int slot;
+	tid_t tid;
+
+	sa = malloc (sizeof *sa);
+	if (sa == NULL)
+		return TID_ERROR;
+
+	/* Reserve a stack slot.  The main thread does not use one. */
+	lock_acquire (&proc->lock);
+	for (slot = 0; slot < PROCESS_THREAD_MAX - 1; slot++)
+		if ((proc->stack_slots & (1u << slot)) == 0)
+			break;
+	if (slot < PROCESS_THREAD_MAX - 1) {
+		proc->stack_slots |= 1u << slot;
+		proc->thread_cnt++;
+	}
+	lock_release (&proc->lock);
+	if (slot == PROCESS_THREAD_MAX - 1) {
+		free (sa);
+		return TID_ERROR;
+	}
+
+	stack_top = setup_thread_stack (slot);
+	if (stack_top == NULL)
+		goto error;
+
+	memset (&sa->if_, 0, sizeof sa->if_);
+	sa->if_.ds = sa->if_.es = sa->if_.ss = SEL_UDSEG;
+	sa->if_.cs = SEL_UCSEG;
+	sa->if_.eflags = FLAG_IF | FLAG_MBS;
+	sa->if_.rip = (uintptr_t) entry;
+	sa->if_.R.rdi = (uint64_t) func;
+	sa->if_.R.rsi = (uint64_t) aux;
+	sa->if_.rsp = (uintptr_t) (stack_top - sizeof (void *));	/* As if ENTRY had been called. */
+	sa->process = proc;
+	sa->pml4 = curr->pml4;
+	sa->stack_slot = slot;
+
+	tid = thread_create (curr->name, curr->base_priority, start_thread, sa);
+	if (tid == TID_ERROR)
+		goto error;
+
+	/* thread_create() recorded the new thread as our child.  Mark it
+	   so that wait() leaves it to thread_join(). */
+	info = list_entry (list_back (&curr->child_list), struct child_info, elem_c);
+	ASSERT (info->tid == tid);
+	info->is_thread = true;
+	return tid;
+
+error:
+	lock_acquire (&proc->lock);
+	proc->stack_slots &= ~(1u << slot);
+	proc->thread_cnt--;
+	lock_release (&proc->lock);
+	free (sa);
+	return TID_ERROR;
+}
+
+/* Thread function of a thread_spawn()ed thread.  Joins the
+   process that SA_ names and drops into user mode. */
+static void
+start_thread (void *sa_) {
+	struct spawn_args *sa = sa_;
+	struct thread *curr = thread_current ();
+	struct intr_frame if_;
+
+	memcpy (&if_, &sa->if_, sizeof if_);
+	curr->process = sa->process;
+	curr->pml4 = sa->pml4;
+	curr->stack_slot = sa->stack_slot;
+	free (sa);
+
+	process_activate (curr);
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* Waits for thread TID, which the current thread must have
+   created with thread_spawn(), to exit and returns its exit
+   status, or returns -1 at once like process_wait(). */
+int
+process_join (tid_t tid) {
+	return wait_child (tid, true);
+}
+
+/* Does the work of process_wait() if IS_THREAD is false, or of
+   process_join() if it is true. */
+static int
+wait_child (tid_t child_tid, bool is_thread) {
 	struct thread *curr = thread_current();
 	int ret;
 
@@ -324,6 +473,8 @@ process_wait (tid_t child_tid) {
 		zombie = list_entry(elem_zombie, struct child_info, elem_c);  
 
 		if(zombie->tid == child_tid) {
+			if (zombie->is_thread != is_thread)
+				return -1;
 			
 			while (zombie->is_zombie == false)
 			{	
@@ -331,7 +482,7 @@ process_wait (tid_t child_tid) {
 			}															// 이 밑으로는 자식이 무조건 진짜 죽은 후임
 			ret = zombie->exit_status;									// 자식이 죽을 때 적어둔 exit_status
 			list_remove(elem_zombie);									// 자식이 사용하던 child_info 구조체를 연결리스트에서 빼버림
-			free(zombie);												// 자식이 사용하던 child_info 구조체 free 
+			kmem_cache_free (child_info_cache, zombie);												// 자식이 사용하던 child_info 구조체 free 
 			return ret;													
 		}
 		elem_zombie = list_next(elem_zombie);		
@@ -341,34 +492,108 @@ process_wait (tid_t child_tid) {
 
 }
 
+/* Ends the current process with exit status STATUS, unless
+   another of its threads has already ended it.  Every thread of
+   the process exits; see struct process. */
+void
+process_terminate (int status) {
+	struct thread *curr = thread_current ();
+	struct process *proc = curr->process;
+
+	ASSERT (proc != NULL);
+
+	lock_acquire (&proc->lock);
+	if (!proc->exiting) {
+		proc->exiting = true;
+		proc->exit_status = status;
+	}
+	lock_release (&proc->lock);
+
+	/* Threads asleep in the user library's locks would otherwise
+	   never get back to user mode. */
+	futex_wake_all (curr->pml4);
+
+	curr->exit_status = status;
+	thread_exit ();
+}
+
+/* Returns true if the current thread belongs to a user process
+   that is exiting, in which case it should exit instead of
+   returning to user mode. */
+bool
+process_exiting (void) {
+	struct process *proc = thread_current ()->process;
+
+	return proc != NULL && proc->exiting;
+}
+
 /* Exit the process. This function is called by thread_exit (). */
 void
 process_exit (void) {
 	struct thread *curr = thread_current ();
+	struct process *proc = curr->process;
 	/* TODO: Your code goes here.
 	 * TODO: Implement process termination message (see
 	 * TODO: project2/process_termination.html).
 	 * TODO: We recommend you to implement process resource cleanup here. */
 
+	if (proc != NULL && proc->main != curr) {
+		/* A thread_spawn()ed thread leaves the process to its main
+		   thread.  Let go of the address space before the main
+		   thread can destroy it. */
+		curr->pml4 = NULL;
+		curr->process = NULL;
+		pml4_activate (NULL);
+
+		lock_acquire (&proc->lock);
+		proc->stack_slots &= ~(1u << curr->stack_slot);
+		proc->thread_cnt--;
+		cond_signal (&proc->threads_done, &proc->lock);
+		lock_release (&proc->lock);
+	}
+	else if (proc != NULL) {
+		/* The main thread goes last.  If it is the first to go,
+		   the others go with it. */
+		lock_acquire (&proc->lock);
+		if (!proc->exiting) {
+			proc->exiting = true;
+			proc->exit_status = curr->exit_status;
+		}
+		lock_release (&proc->lock);
+		futex_wake_all (curr->pml4);
+
+		lock_acquire (&proc->lock);
+		while (proc->thread_cnt > 1)
+			cond_wait (&proc->threads_done, &proc->lock);
+		lock_release (&proc->lock);
+		curr->exit_status = proc->exit_status;
+	}
 
 	if(curr->pml4 != NULL) {
 		printf("%s: exit(%d)\n", curr->name, curr->exit_status);
+		if (thread_report_usage)
+			thread_print_usage (curr);
 	}
 
 	process_cleanup ();		// 본인이 사용한 자원 청소
 	// 파일 다 닫기
-	bool filesys_lock_taken_here = false;
+	if (curr->process != NULL) {
+		bool filesys_lock_taken_here = false;
 
-	if ( !lock_held_by_current_thread(&filesys_lock))
-	{
-		lock_acquire(&filesys_lock);
-		filesys_lock_taken_here = true;
-	}
-	for (int i = FD_MIN; i < FD_MAX; i++) {
-		file_close(curr->fd_array[i]);
+		if ( !rwlock_held_by_current_thread(&filesys_lock))
+		{
+			rwlock_acquire_write(&filesys_lock);
+			filesys_lock_taken_here = true;
+		}
+		for (int i = FD_MIN; i < FD_MAX; i++) {
+			file_close(curr->process->fd_array[i]);
+		}
+		// file_close(curr->current_file); // -> process_cleanup으로 이사함
+		if (filesys_lock_taken_here) rwlock_release_write(&filesys_lock);
+
+		free (curr->process);
+		curr->process = NULL;
 	}
-	// file_close(curr->current_file); // -> process_cleanup으로 이사함
-	if (filesys_lock_taken_here) lock_release(&filesys_lock);
 
 	// 좀비 청소 + 고아들 해방시켜주기	(자식도 자식이 있을 수 있는 것)
 	struct list_elem *elem_orphan;
@@ -380,12 +605,12 @@ process_exit (void) {
 
 		if(orphan->is_zombie) {					
 			list_remove(elem_orphan);				// 알아서 죽은(부모의 wait와 별개로 그냥 혼자 죽은 경우) 자식들의 child_info를 child_list에서 뺌
-			free(orphan);							// 알아서 죽은(부모의 wait와 별개로 그냥 혼자 죽은 경우) 자식들의 child_info를 free	
+			kmem_cache_free (child_info_cache, orphan);							// 알아서 죽은(부모의 wait와 별개로 그냥 혼자 죽은 경우) 자식들의 child_info를 free	
 		} 
 		else { 										// 이제 부모 없을거니까 자기 정보 안알려줘도 되게 만들어줘야함
 			list_remove(elem_orphan);				// 아직 살아있는 자식들의 child_info를 child_list에서 뺌
 			orphan->child_thread->my_info = NULL;	// 자식의 child_info는 이제 필요없어져서 free 할 것인데, 그 반환된 공간에 자식(자식)이 죽으면서 자신(자식)의 정보를 적으려 접근하지 못하게 포인터를 NULL로 바꿔줌
-			free(orphan);	 						// 이제 부모가 없으니까 자식은 자신이 죽을 때 자신의 정보를 적어줄 필요가 없으니까 child_info free
+			kmem_cache_free (child_info_cache, orphan);	 						// 이제 부모가 없으니까 자식은 자신이 죽을 때 자신의 정보를 적어줄 필요가 없으니까 child_info free
 		}		
 	}
 	if(curr->my_info) { 									// 명시적으로 부모한테 자식(나)의 죽음 정보 알려주기
@@ -402,17 +627,20 @@ process_cleanup (void) {
 	struct thread *curr = thread_current ();
 	bool filesys_lock_taken_here = false;
 
-	if ( !lock_held_by_current_thread(&filesys_lock))
+	if ( !rwlock_held_by_current_thread(&filesys_lock))
 	{
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		filesys_lock_taken_here = true;
 	}
 	file_close(curr->current_file);
 	curr->current_file = NULL;
-	if (filesys_lock_taken_here) lock_release(&filesys_lock);
+	if (filesys_lock_taken_here) rwlock_release_write(&filesys_lock);
 	
 #ifdef VM
-	supplemental_page_table_kill (&curr->spt);
+	if (curr->process != NULL) {
+		work_cancel_sync (&curr->process->writeback);
+		supplemental_page_table_kill (&curr->process->spt);
+	}
 #endif
 
 	uint64_t *pml4;
@@ -505,11 +733,21 @@ struct ELF64_PHDR {
 #define Phdr ELF64_PHDR
 
 static bool setup_stack (struct intr_frame *if_);
+static void *thread_stack_top (int slot);
 static bool validate_segment (const struct Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes,
 		bool writable);
 
+/* Returns the top of the user stack in stack slot SLOT.  The
+   main thread's stack may grow down to 1 MB below USER_STACK.
+   The slots come after it, each below an unmapped guard page. */
+static void *
+thread_stack_top (int slot) {
+	return (uint8_t *) USER_STACK - 0x100000 - PGSIZE
+		- (size_t) slot * (THREAD_STACK_PAGES + 1) * PGSIZE;
+}
+
 /* Loads an ELF executable from FILE_NAME into the current thread.
  * Stores the executable's entry point into *RIP
  * and its initial stack pointer into *RSP.
@@ -842,6 +1080,31 @@ setup_stack (struct intr_frame *if_) {
 	return success;
 }
 
+/* Maps the user stack of stack slot SLOT, unless an earlier
+   thread in the slot left it mapped, and returns its top.
+   Returns a null pointer if out of memory. */
+static void *
+setup_thread_stack (int slot) {
+	uint8_t *top = thread_stack_top (slot);
+	int i;
+
+	for (i = 1; i <= THREAD_STACK_PAGES; i++) {
+		uint8_t *upage = top - i * PGSIZE;
+		uint8_t *kpage;
+
+		if (pml4_get_page (thread_current ()->pml4, upage) != NULL)
+			continue;
+		kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+		if (kpage == NULL)
+			return NULL;
+		if (!install_page (upage, kpage, true)) {
+			palloc_free_page (kpage);
+			return NULL;
+		}
+	}
+	return top;
+}
+
 /* Adds a mapping from user virtual address UPAGE to kernel
  * virtual address KPAGE to the page table.
  * If WRITABLE is true, the user process may modify the page;
@@ -876,21 +1139,21 @@ lazy_load_segment (struct page *page, void *aux) {
 	struct file* file = ((struct args_lazy *)aux)->file;
 	bool filesys_lock_taken_here = false;
 
-	if ( !lock_held_by_current_thread(&filesys_lock))
+	if ( !rwlock_held_by_current_thread(&filesys_lock))
 	{
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_read(&filesys_lock);
 		filesys_lock_taken_here = true;
 	}
 
-	file_seek (file, ofs);
-
-	if (file_read (file, page->frame->kva, page_read_bytes) != (int) page_read_bytes) {
+	/* Other processes may be reading FILE under the same shared
+	   hold, so read at OFS rather than moving its position. */
+	if (file_read_at (file, page->frame->kva, page_read_bytes, ofs) != (int) page_read_bytes) {
 		PANIC("TODO : file_read fail - palloc_free_page (page");
 		return false;
 	}
 	memset (page->frame->kva + page_read_bytes, 0, page_zero_bytes);
 
-	if (filesys_lock_taken_here) lock_release(&filesys_lock);
+	if (filesys_lock_taken_here) rwlock_release_read(&filesys_lock);
 
 	return true;
 }
@@ -924,7 +1187,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		struct args_lazy *aux = (struct args_lazy *) malloc (sizeof(struct args_lazy));
+		struct args_lazy *aux = kmem_cache_alloc (args_lazy_cache);
 		*aux = (struct args_lazy) { 
 				.page_read_bytes = page_read_bytes,
 				.page_zero_bytes = page_zero_bytes,
@@ -969,4 +1232,24 @@ setup_stack (struct intr_frame *if_) {
 
 	return success;
 }
+
+/* Sets up the user stack of stack slot SLOT, unless an earlier
+   thread in the slot left it in place, and returns its top.  The
+   pages are faulted in as the thread touches them.  Returns a
+   null pointer if out of memory. */
+static void *
+setup_thread_stack (int slot) {
+	struct supplemental_page_table *spt = &thread_current ()->process->spt;
+	uint8_t *top = thread_stack_top (slot);
+	int i;
+
+	for (i = 1; i <= THREAD_STACK_PAGES; i++) {
+		uint8_t *upage = top - i * PGSIZE;
+
+		if (spt_find_page (spt, upage) == NULL
+				&& !vm_alloc_page (VM_ANON, upage, true))
+			return NULL;
+	}
+	return top;
+}
 #endif /* VM */
@@ -16,6 +16,8 @@
 #include "userprog/process.h"
 #include "threads/palloc.h"
 #include "vm/vm.h"
+#include "userprog/futex.h"
+#include "devices/timer.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
@@ -39,6 +41,14 @@ void close_handler (struct intr_frame *);
 void dup2_handler (struct intr_frame *);
 void mmap_handler (struct intr_frame *);
 void munmap_handler (struct intr_frame *);
+void getrusage_handler (struct intr_frame *);
+void set_tickets_handler (struct intr_frame *);
+void futex_wait_handler (struct intr_frame *);
+void futex_wake_handler (struct intr_frame *);
+void thread_spawn_handler (struct intr_frame *);
+void thread_join_handler (struct intr_frame *);
+void clock_gettime_handler (struct intr_frame *);
+void thread_quit_handler (struct intr_frame *);
 
 /* helper functions proto */
 void error_exit (void);
@@ -79,7 +89,7 @@ bool is_bad_ptr (void *, bool);
 #define is_STDOUT(fd)		(fd == STDOUT_FILENO)
 
 /* macro for reference fd_array */
-#define fd_file(fd)			(curr->fd_array[fd])
+#define fd_file(fd)			(curr->process->fd_array[fd])
 
 void
 syscall_init (void) {
@@ -96,7 +106,8 @@ syscall_init (void) {
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 	
-	lock_init(&filesys_lock);
+	rwlock_init_named(&filesys_lock, "filesys");
+	futex_init ();
 }
 
 
@@ -128,9 +139,23 @@ syscall_handler (struct intr_frame *f UNUSED) {
         {SYS_CLOSE, close_handler},                 /* Close a file. */
 		{SYS_MMAP, mmap_handler},					/* Map a file into memory. */
 		{SYS_MUNMAP, munmap_handler},				/* Remove a memory mapping. */
+		[SYS_GETRUSAGE] = {SYS_GETRUSAGE, getrusage_handler},	/* Get CPU and scheduling statistics. */
+		[SYS_SET_TICKETS] = {SYS_SET_TICKETS, set_tickets_handler},	/* Set the stride scheduler share. */
+		[SYS_FUTEX_WAIT] = {SYS_FUTEX_WAIT, futex_wait_handler},	/* Sleep if a user int holds a value. */
+		[SYS_FUTEX_WAKE] = {SYS_FUTEX_WAKE, futex_wake_handler},	/* Wake threads sleeping on a user int. */
+		[SYS_THREAD_SPAWN] = {SYS_THREAD_SPAWN, thread_spawn_handler},	/* Start a thread in this process. */
+		[SYS_THREAD_JOIN] = {SYS_THREAD_JOIN, thread_join_handler},	/* Wait for a thread to exit. */
+		[SYS_CLOCK_GETTIME] = {SYS_CLOCK_GETTIME, clock_gettime_handler},	/* Read a clock in nanoseconds. */
+		[SYS_THREAD_QUIT] = {SYS_THREAD_QUIT, thread_quit_handler},	/* Terminate this thread only. */
     };
 
     actions[SYSCALL_NUM].function(f);
+
+	/* Another thread may have ended the process meanwhile. */
+	if (process_exiting ()) {
+		thread_current ()->exit_status = -1;
+		thread_exit ();
+	}
 }
 
 void
@@ -141,10 +166,8 @@ halt_handler (struct intr_frame *f) {
 void
 exit_handler (struct intr_frame *f) {
     int status = (int) ARG1;
-	struct thread *curr = thread_current();
-	curr->exit_status = status;
 
-    thread_exit();
+	process_terminate (status);
 }
 
 void
@@ -194,9 +217,9 @@ create_handler (struct intr_frame *f) {
 		error_exit();
 	} 
 	else { 
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		success = filesys_create (file, initial_size);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 
 		RET_VAL = success;
 		return;
@@ -213,9 +236,9 @@ remove_handler (struct intr_frame *f) {
 		RET_VAL = false;
 		error_exit();
 	} else {
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		RET_VAL = filesys_remove(file);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 
 		return;
 	}
@@ -235,25 +258,28 @@ open_handler (struct intr_frame *f) {
 		error_exit();
 	} 
 	else { 
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		file_ptr = filesys_open (file);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 
 		if (file_ptr){
 			int i = FD_MIN;
 			
-			lock_acquire(&filesys_lock);
+			rwlock_acquire_write(&filesys_lock);
 			while (fd_file(i)) { // look up null
 				i++;
 				if (i==FD_MAX) {
 					file_close (file_ptr);
+					rwlock_release_write(&filesys_lock);
 					RET_VAL = -1;
 					return;
 					}
 			}
-			lock_release(&filesys_lock);
-
+			/* Claim the slot before other threads of the process
+			   can see it empty. */
 			fd_file(i) = file_ptr;
+			rwlock_release_write(&filesys_lock);
+
 			fd = i;
 
 			RET_VAL = fd; 
@@ -272,9 +298,9 @@ filesize_handler (struct intr_frame *f) {
 	ASSERT(fd != NULL);
 	ASSERT(file_ptr != NULL);
 
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_read(&filesys_lock);
 	RET_VAL = file_length(file_ptr);
-	lock_release(&filesys_lock);
+	rwlock_release_read(&filesys_lock);
 
 }
 
@@ -295,9 +321,9 @@ read_handler (struct intr_frame *f) {
 		RET_VAL = -1;
 		error_exit();
 	} else {
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_read(&filesys_lock);
 		RET_VAL = file_read(file_ptr, buffer, size);
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 	}
 }
 
@@ -321,9 +347,9 @@ write_handler (struct intr_frame *f) {
 		RET_VAL = 0;
 		error_exit();
 	} else {
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		RET_VAL = file_write (file_ptr, buffer, size);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 	}
 }
 
@@ -340,14 +366,25 @@ seek_handler (struct intr_frame *f) {
 
 	file = fd_file(fd);
 
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	file_seek(file, position);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 }
 
 void
 tell_handler (struct intr_frame *f) {
     int fd = (int) ARG1;
+	struct file *file_ptr;
+	struct thread *curr = thread_current();
+
+	if (is_bad_fd(fd) || !(file_ptr = fd_file(fd))) {
+		RET_VAL = -1;
+		error_exit();
+	}
+
+	rwlock_acquire_read(&filesys_lock);
+	RET_VAL = file_tell(file_ptr);
+	rwlock_release_read(&filesys_lock);
 }
 
 void
@@ -365,10 +402,10 @@ close_handler (struct intr_frame *f) {
 	else {
 		ASSERT(file_ptr != NULL);
 
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		file_close(file_ptr);
 		fd_file(fd) = NULL;
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 	}
 }
 
@@ -398,8 +435,8 @@ mmap_handler (struct intr_frame *f) {
 		|| (((long long unsigned)offset != pg_round_down(offset)))
 		|| !is_user_vaddr(addr)
 		|| length == 0
-		|| spt_find_page(&thread_current()->spt, addr)
-		|| spt_find_page(&thread_current()->spt, addr+length-1)
+		|| spt_find_page(&thread_current()->process->spt, addr)
+		|| spt_find_page(&thread_current()->process->spt, addr+length-1)
 		|| fd == NULL
 		|| fd < FD_MIN
 		|| fd > FD_MAX
@@ -418,19 +455,124 @@ mmap_handler (struct intr_frame *f) {
 void
 munmap_handler (struct intr_frame *f) {
 	void *addr = ARG1;
-	if (addr == NULL || spt_find_page(&thread_current()->spt, addr) == NULL) 
+	if (addr == NULL || spt_find_page(&thread_current()->process->spt, addr) == NULL) 
 	{	
 		return;
 	}
 	else do_munmap(addr);
 }
 
-void error_exit() {
+void
+getrusage_handler (struct intr_frame *f) {
+	struct rusage *usage = (struct rusage *) ARG1;
+	struct rusage snapshot;
+	enum intr_level old_level;
+
+	if (is_bad_ptr(usage, true)
+		|| is_bad_ptr((char *) usage + sizeof *usage - 1, true)) {
+		RET_VAL = -1;
+		error_exit();
+	}
+
+	/* The timer interrupt updates the counters, so take a consistent
+	   copy first.  Writing to USAGE may fault the page in. */
+	old_level = intr_disable ();
+	snapshot = thread_current ()->usage;
+	intr_set_level (old_level);
+
+	*usage = snapshot;
+	RET_VAL = 0;
+}
+
+void
+set_tickets_handler (struct intr_frame *f) {
+	int tickets = (int) ARG1;
+
+	RET_VAL = thread_set_tickets (tickets);
+}
+
+void
+futex_wait_handler (struct intr_frame *f) {
+	int *addr = (int *) ARG1;
+	int expected = (int) ARG2;
+	int64_t timeout = (int64_t) ARG3;
+
+	if (is_bad_ptr(addr, false) || (uintptr_t) addr % sizeof (int) != 0) {
+		RET_VAL = -1;
+		error_exit();
+	}
+	else
+		RET_VAL = futex_wait (addr, expected, timeout);
+}
+
+void
+futex_wake_handler (struct intr_frame *f) {
+	int *addr = (int *) ARG1;
+	int cnt = (int) ARG2;
+
+	if (is_bad_ptr(addr, false) || (uintptr_t) addr % sizeof (int) != 0) {
+		RET_VAL = -1;
+		error_exit();
+	}
+	else
+		RET_VAL = cnt > 0 ? futex_wake (addr, cnt) : 0;
+}
+
+void
+thread_spawn_handler (struct intr_frame *f) {
+	void *entry = (void *) ARG1;
+	void *func = (void *) ARG2;
+	void *aux = (void *) ARG3;
+
+	if (entry == NULL || !is_user_vaddr (entry)) {
+		RET_VAL = TID_ERROR;
+		error_exit();
+	}
+	else
+		RET_VAL = process_spawn (entry, func, aux);
+}
+
+void
+thread_join_handler (struct intr_frame *f) {
+	tid_t tid = (tid_t) ARG1;
+
+	RET_VAL = process_join (tid);
+}
+
+void
+thread_quit_handler (struct intr_frame *f) {
+	int status = (int) ARG1;
 	struct thread *curr = thread_current();
-	curr->exit_status = -1;
+
+	/* Only this thread exits, unless it is the main one. */
+	curr->exit_status = status;
 	thread_exit();
 }
 
+void
+clock_gettime_handler (struct intr_frame *f) {
+	int clock_id = (int) ARG1;
+	struct timespec *ts = (struct timespec *) ARG2;
+	int64_t ns;
+
+	if (is_bad_ptr(ts, true)
+		|| is_bad_ptr((char *) ts + sizeof *ts - 1, true)) {
+		RET_VAL = -1;
+		error_exit();
+	} else if (clock_id != CLOCK_MONOTONIC)
+		RET_VAL = -1;
+	else {
+		ns = timer_ns ();
+		ts->tv_sec = ns / 1000000000;
+		ts->tv_nsec = ns % 1000000000;
+		RET_VAL = 0;
+	}
+}
+
+void error_exit() {
+	process_terminate (-1);
+}
+
 bool 
 is_bad_fd (int fd) {
 	bool is_valid;
@@ -446,10 +588,10 @@ is_bad_ptr (void *ptr, bool to_write) {
 	struct page *e_page;
 
 	if (to_write) {
-		is_valid = (ptr && is_user_vaddr(ptr) && (e_page = spt_find_page (&curr->spt, ptr)) && e_page->writable);
+		is_valid = (ptr && is_user_vaddr(ptr) && (e_page = spt_find_page (&curr->process->spt, ptr)) && e_page->writable);
 	}
 	else {
-		is_valid = (ptr && is_user_vaddr(ptr) && (e_page = spt_find_page (&curr->spt, ptr)));
+		is_valid = (ptr && is_user_vaddr(ptr) && (e_page = spt_find_page (&curr->process->spt, ptr)));
 	}
 
 	return !is_valid;
@@ -22,7 +22,7 @@ void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
 	swap_disk = disk_get(1, 1);
-	lock_init(&st.lock);
+	lock_init_named(&st.lock, "swap table");
 	st.slots_map = bitmap_create(SLOT_MAX_CNT);
 }
 
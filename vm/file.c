@@ -1,6 +1,13 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include "userprog/process.h"
+#include "devices/timer.h"
+
+struct kmem_cache *args_lazy_mm_cache;
+
+/* Ticks between writebacks of a process's dirty mmap pages. */
+#define MMAP_WRITEBACK_INTERVAL TIMER_FREQ
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -18,6 +25,10 @@ static const struct page_operations file_ops = {
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	args_lazy_mm_cache = kmem_cache_create ("args_lazy_mm",
+			sizeof (struct args_lazy_mm), NULL);
+	if (args_lazy_mm_cache == NULL)
+		PANIC ("cannot create args_lazy_mm cache");
 }
 
 /* Initialize the file backed page */
@@ -50,19 +61,20 @@ file_backed_swap_in (struct page *page, void *kva) {
 		bool filesys_lock_taken_here = false;
 
 
-		if ( !lock_held_by_current_thread(&filesys_lock))
+		if ( !rwlock_held_by_current_thread(&filesys_lock))
 		{
-			lock_acquire(&filesys_lock);
+			rwlock_acquire_read(&filesys_lock);
 			filesys_lock_taken_here = true;
 		}
 
 		if(file_read_at(file, kva, read_bytes, ofs) != (int)read_bytes) {
+			if (filesys_lock_taken_here) rwlock_release_read(&filesys_lock);
 			return false;
 		}
 
 		memset (kva + read_bytes, 0, zero_bytes);
 
-		if (filesys_lock_taken_here) lock_release(&filesys_lock);
+		if (filesys_lock_taken_here) rwlock_release_read(&filesys_lock);
 
 	}
 
@@ -81,9 +93,9 @@ file_backed_swap_out (struct page *page) {
 	bool filesys_lock_taken_here = false;
 
 
-	if ( !lock_held_by_current_thread(&filesys_lock))
+	if ( !rwlock_held_by_current_thread(&filesys_lock))
 	{
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		filesys_lock_taken_here = true;
 	}
 
@@ -93,7 +105,7 @@ file_backed_swap_out (struct page *page) {
 		pml4_set_dirty(page->pml4, page->va, false);
 	}
 	
-	if (filesys_lock_taken_here) lock_release(&filesys_lock);
+	if (filesys_lock_taken_here) rwlock_release_write(&filesys_lock);
 
 	// 얘랑 연결만 끊어 frame + pml4 에서도 지워야지
 	// 	frame table에서 놔둬야해 -> 다른 애가 써야하니까 eviction = swap out 하는거
@@ -115,9 +127,9 @@ file_backed_destroy (struct page *page) {
 
 	// printf(":::page addr %p file backed destroy called:::\n", page);
 
-	if ( !lock_held_by_current_thread(&filesys_lock))
+	if ( !rwlock_held_by_current_thread(&filesys_lock))
 	{
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		filesys_lock_taken_here = true;
 	}
 
@@ -136,9 +148,9 @@ file_backed_destroy (struct page *page) {
 		aux->mmap_cnt = NULL;
 
 	}
-	if (filesys_lock_taken_here) lock_release(&filesys_lock);
+	if (filesys_lock_taken_here) rwlock_release_write(&filesys_lock);
 
-	free(aux);
+	kmem_cache_free (args_lazy_mm_cache, aux);
 	file_page->aux = NULL;
 
 	// memset(frame->kva, 0, PGSIZE);
@@ -150,7 +162,7 @@ file_backed_destroy (struct page *page) {
 		
 		ft_remove_frame (frame);
 		palloc_free_page(frame->kva);
-		free(frame);
+		kmem_cache_free (frame_cache, frame);
 	} 
 	
 
@@ -176,15 +188,15 @@ do_mmap (void *addr, size_t length, int writable,
 
 	*mmap_cnt = (zero_bytes + read_bytes) / PGSIZE;
 
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	file = file_reopen(file);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	
 	while (read_bytes > 0 || zero_bytes > 0) {
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		struct args_lazy_mm *aux = (struct args_lazy_mm *) malloc (sizeof(struct args_lazy_mm));
+		struct args_lazy_mm *aux = kmem_cache_alloc (args_lazy_mm_cache);
 		*aux = (struct args_lazy_mm) { 
 				.page_read_bytes = page_read_bytes,
 				.page_zero_bytes = page_zero_bytes,
@@ -203,20 +215,86 @@ do_mmap (void *addr, size_t length, int writable,
 		offset += PGSIZE;
 	}
 
+	work_queue_delayed (&thread_current ()->process->writeback,
+			MMAP_WRITEBACK_INTERVAL);
 	return given_addr;
 }
 
+/* Work function that writes back the dirty pages that PROC_, a
+   struct process, has mapped from files, so that evicting them
+   later takes no disk write on the page fault path.  Runs again
+   every MMAP_WRITEBACK_INTERVAL ticks while the process has
+   any mapping. */
+void
+mmap_writeback (void *proc_) {
+	struct process *proc = proc_;
+	struct supplemental_page_table *spt = &proc->spt;
+	struct hash_iterator i;
+	bool mapped = true;
+	void *buffer;
+
+	buffer = palloc_get_page (0);
+	if (buffer == NULL)
+		goto again;
+
+	/* A thread of the process may fault while holding
+	   FILESYS_LOCK, and then wants SPT's lock, so only try for
+	   that one and come back later if it is busy. */
+	rwlock_acquire_write (&filesys_lock);
+	if (!lock_try_acquire (&spt->lock)) {
+		rwlock_release_write (&filesys_lock);
+		palloc_free_page (buffer);
+		goto again;
+	}
+
+	mapped = false;
+	hash_first (&i, &spt->pages);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, elem_spt);
+		enum intr_level old_level;
+		bool dirty = false;
+
+		if (page_get_type (page) != VM_FILE)
+			continue;
+		mapped = true;
+		if (page->operations->type != VM_FILE || page->file.aux == NULL)
+			continue;
+
+		/* Take a copy and clear the dirty bit in one step, so that
+		   a write by the process in between is not lost.  Holding
+		   FILESYS_LOCK keeps the frame from being evicted. */
+		old_level = intr_disable ();
+		if (page->frame != NULL && pml4_is_dirty (page->pml4, page->va)) {
+			memcpy (buffer, page->frame->kva, PGSIZE);
+			pml4_set_dirty (page->pml4, page->va, false);
+			dirty = true;
+		}
+		intr_set_level (old_level);
+
+		if (dirty)
+			file_backed_write_back (page->file.aux, buffer);
+	}
+
+	lock_release (&spt->lock);
+	rwlock_release_write (&filesys_lock);
+	palloc_free_page (buffer);
+
+again:
+	if (mapped)
+		work_queue_delayed (&proc->writeback, MMAP_WRITEBACK_INTERVAL);
+}
+
 /* Do the munmap */
 void
 do_munmap (void *addr) {
-	struct page *e_page = spt_find_page(&thread_current()->spt, addr);
+	struct page *e_page = spt_find_page(&thread_current()->process->spt, addr);
 	struct args_lazy_mm *aux = e_page->file.aux;
 	unsigned *mmap_cnt = aux->mmap_cnt;
 
 	while (e_page && *mmap_cnt) {
-		spt_remove_page(&thread_current()->spt, e_page);
+		spt_remove_page(&thread_current()->process->spt, e_page);
 		addr += PGSIZE;
-		e_page = spt_find_page(&thread_current()->spt, addr);
+		e_page = spt_find_page(&thread_current()->process->spt, addr);
 	}
 }
 
@@ -228,23 +306,24 @@ lazy_load_segment_mmap (struct page *page, void *aux) {
 	struct file* file = ((struct args_lazy_mm *)aux)->file;
 	bool filesys_lock_taken_here = false;
 
-	if ( !lock_held_by_current_thread(&filesys_lock))
+	if ( !rwlock_held_by_current_thread(&filesys_lock))
 	{
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_read(&filesys_lock);
 		filesys_lock_taken_here = true;
 	}
 
-	file_seek (file, ofs);
-
 	size_t read_result;
 
-	if ((read_result = file_read (file, page->frame->kva, page_read_bytes)) != (int) page_read_bytes) {
+	/* Only shared, so read at OFS rather than moving the position of
+	   a FILE that a forked process may be faulting in as well. */
+	if ((read_result = file_read_at (file, page->frame->kva, page_read_bytes, ofs)) != (int) page_read_bytes) {
 		// PANIC("TODO : file_read fail 하면 palloc_free_page \n");
+		if (filesys_lock_taken_here) rwlock_release_read(&filesys_lock);
 		return false;
 	}
 	memset (page->frame->kva + page_read_bytes, 0, page_zero_bytes);
 
-	if (filesys_lock_taken_here) lock_release(&filesys_lock);
+	if (filesys_lock_taken_here) rwlock_release_read(&filesys_lock);
 
 	return true;
 }
@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "vm/file.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -69,7 +70,10 @@ uninit_destroy (struct page *page) {
 	// printf(":::uninit destory called:::\n");
 
 	if(uninit->aux) {
-		free(uninit->aux);
+		if (VM_TYPE (uninit->type) == VM_FILE)
+			kmem_cache_free (args_lazy_mm_cache, uninit->aux);
+		else
+			kmem_cache_free (args_lazy_cache, uninit->aux);
 	}
 	if(page->frame) {
 		pml4_clear_page(page->pml4, page->va);
@@ -78,7 +82,7 @@ uninit_destroy (struct page *page) {
 		palloc_free_page (page->frame->kva);
 		page->frame->page = NULL;
 
-		free(page->frame);
+		kmem_cache_free (frame_cache, page->frame);
 		page->frame = NULL;
 	}
 }
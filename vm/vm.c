@@ -2,12 +2,24 @@
 
 #include "threads/malloc.h"
 #include "vm/vm.h"
+#include "userprog/process.h"
 #include "vm/inspect.h"
 
+struct kmem_cache *page_cache;
+struct kmem_cache *frame_cache;
+struct kmem_cache *args_lazy_cache;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
 vm_init (void) {
+	page_cache = kmem_cache_create ("page", sizeof (struct page), NULL);
+	frame_cache = kmem_cache_create ("frame", sizeof (struct frame), NULL);
+	args_lazy_cache = kmem_cache_create ("args_lazy",
+			sizeof (struct args_lazy), NULL);
+	if (page_cache == NULL || frame_cache == NULL || args_lazy_cache == NULL)
+		PANIC ("cannot create VM caches");
+
 	vm_anon_init ();
 	vm_file_init ();
 #ifdef EFILESYS  /* For project 4 */
@@ -40,7 +52,9 @@ page_get_type (struct page *page) {
 /* Helpers */
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
+static bool claim_with_frame (struct page *page, struct frame *frame);
 static struct frame *vm_evict_frame (void);
+static size_t count_resident (struct supplemental_page_table *spt);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -50,7 +64,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		vm_initializer *init, void *aux) {
 	ASSERT (VM_TYPE(type) != VM_UNINIT)
 
-	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct supplemental_page_table *spt = &thread_current ()->process->spt;
 	
 	/* Check whether the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
@@ -58,7 +72,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
 
-		struct page *new_page = (struct page *) malloc(sizeof(struct page));
+		struct page *new_page = kmem_cache_alloc (page_cache);
 		bool (*initializer)(struct page *, enum vm_type, void *);
 
 		if (!new_page) 
@@ -96,7 +110,9 @@ spt_find_page (struct supplemental_page_table *spt, void *va ) {
 
 	struct hash_elem *e;
 	e_page.va = pg_round_down(va);
+	lock_acquire (&spt->lock);
 	e = hash_find (&spt->pages, &e_page.elem_spt);
+	lock_release (&spt->lock);
 	page = e != NULL ? hash_entry (e, struct page, elem_spt) : NULL;
 
 	return page;
@@ -108,17 +124,20 @@ spt_insert_page (struct supplemental_page_table *spt, struct page *page ) {
 	int succ = false;
 	/* TODO: Fill this function. */
 	
-	if(hash_insert(&spt->pages, &page->elem_spt) == NULL) {
+	lock_acquire (&spt->lock);
+	if(hash_insert(&spt->pages, &page->elem_spt) == NULL)
 		succ = true;
-	    ASSERT(spt_find_page(spt, page->va) == page);
-	}
+	lock_release (&spt->lock);
+	ASSERT(!succ || spt_find_page(spt, page->va) == page);
 
 	return succ;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	lock_acquire (&spt->lock);
 	hash_delete (&spt->pages, &page->elem_spt);
+	lock_release (&spt->lock);
 	
 	lock_acquire(&ft.lock);
 	vm_dealloc_page (page);
@@ -136,7 +155,7 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
-	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct supplemental_page_table *spt = &thread_current()->process->spt;
 	/* TODO: The policy for eviction is up to you. */
    	struct frame *e_frame;
 	struct hash_iterator i;
@@ -211,7 +230,7 @@ vm_evict_frame (void) {
  * space.*/
 static struct frame *
 vm_get_frame (void) {
-	struct frame *frame = (struct frame *)malloc( sizeof(struct frame));
+	struct frame *frame = kmem_cache_alloc (frame_cache);
 	/* TODO: Fill this function. */
 	// palloc 하면 userpool or kernel pool에서 가져와 가져온걸 우리가 frame table에서 관리 하게 됨
 
@@ -220,7 +239,7 @@ vm_get_frame (void) {
 	frame->kva = palloc_get_page(PAL_USER | PAL_ZERO); // userpool에서 0으로 초기화된 새 frame (page size) 가져옴
 	
 	if (frame->kva == NULL) {
-		free(frame);
+		kmem_cache_free (frame_cache, frame);
 		frame = vm_evict_frame();
 	} else {
 		ft_insert_frame(frame);
@@ -239,7 +258,7 @@ err:
 /* Growing the stack. */
 static void
 vm_stack_growth (void *addr) {
-	struct supplemental_page_tagle *spt = &thread_current()->spt;
+	struct supplemental_page_tagle *spt = &thread_current()->process->spt;
 
 	addr = pg_round_down(addr);
 	while (spt_find_page(spt, addr) == NULL) {
@@ -258,7 +277,7 @@ vm_handle_wp (struct page *page UNUSED) {
 bool
 vm_try_handle_fault (struct intr_frame *f, void *addr,
 		bool user UNUSED, bool write, bool not_present) {
-	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct supplemental_page_table *spt = &thread_current ()->process->spt;
 	struct page *page = NULL;
 
 	/* TODO: Validate the fault */
@@ -283,8 +302,9 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 	page = spt_find_page(spt, addr);
 	if (page == NULL) return false;
 
+	/* Another thread of the process may have claimed it first. */
 	lock_acquire(&ft.lock);
-	bool success = vm_do_claim_page (page);
+	bool success = page->frame != NULL || vm_do_claim_page (page);
 	lock_release(&ft.lock);
 	
 	return success;	// vm (page) -> RAM (frame) 이 연결관계가 없을 때 뜨는게 page fault 이기 때문에 이 관계를 claim 해주는 do_claim 을 호출 해서 문제 해결
@@ -295,7 +315,7 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	kmem_cache_free (page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -305,7 +325,7 @@ vm_claim_page (void *va) { // va랑 page 매핑
 	struct thread *curr = thread_current();
 	/* TODO: Fill this function */
 
-	page = spt_find_page(&curr->spt, va);
+	page = spt_find_page(&curr->process->spt, va);
 	if (!page) PANIC("claim panic");
 	
 	page->va = va;
@@ -320,7 +340,13 @@ vm_do_claim_page (struct page *page) { // page <-> frame 매핑
 
 	if(page->va == 0xabae20) printf(":::1206:::\n");
 
-	struct frame *frame = vm_get_frame ();
+	return claim_with_frame (page, vm_get_frame ());
+}
+
+/* Links PAGE to FRAME, which has no page, maps it in the current
+   thread's page table and brings in its contents. */
+static bool
+claim_with_frame (struct page *page, struct frame *frame) {
 	struct thread *curr = thread_current();
 	bool writable = page->writable;
 
@@ -343,52 +369,138 @@ vm_do_claim_page (struct page *page) { // page <-> frame 매핑
 void
 supplemental_page_table_init (struct supplemental_page_table *spt) {
 	// list_init(&spt->list_spt);
+	lock_init (&spt->lock);
 	hash_init(&spt->pages, page_hash, page_less, NULL);
 }
 
-/* Copy supplemental page table from src to dst */
+/* Copy supplemental page table from src to dst.
+
+   Other threads of the parent keep running, so SRC's lock is
+   held while walking it.  Getting a frame may evict a file-backed
+   page, which takes the file system lock exclusive, and a thread
+   of the parent may hold that lock shared while it waits for
+   SRC's lock in a page fault.  So frames for the parent's
+   resident pages are reserved before SRC's lock is taken, and the
+   copies are mapped in after it is released.  If the parent
+   faults in more pages in the meantime, we reserve more and walk
+   SRC again, skipping the pages already copied. */
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src) {
-	bool success;
+	struct frame **frames = NULL;   /* Reserved frames. */
+	struct page **copies = NULL;    /* Page copied into each of FRAMES. */
+	size_t frame_cnt = 0;           /* Number of FRAMES. */
+	size_t copy_cnt = 0;            /* Number of COPIES, a prefix of FRAMES. */
+	bool success = true;
+	bool short_of_frames;
 	struct args_lazy *child_aux;
 	struct args_lazy *parent_aux;
     struct hash_iterator i;
-    
-	hash_first (&i, &src->pages);
-
-    while (hash_next (&i)) 
-    {
-		struct page *parent_page = hash_entry (hash_cur (&i), struct page, elem_spt);
-		if (parent_page == NULL) goto err;
+	size_t j;
+
+	do {
+		size_t want = copy_cnt + count_resident (src);
+
+		/* Reserve frames with no SPT lock held. */
+		if (want > frame_cnt) {
+			struct frame **new_frames = realloc (frames, want * sizeof *frames);
+			struct page **new_copies = realloc (copies, want * sizeof *copies);
+
+			if (new_frames != NULL)
+				frames = new_frames;
+			if (new_copies != NULL)
+				copies = new_copies;
+			if (new_frames == NULL || new_copies == NULL) {
+				success = false;
+				break;
+			}
+			lock_acquire (&ft.lock);
+			while (frame_cnt < want)
+				frames[frame_cnt++] = vm_get_frame ();
+			lock_release (&ft.lock);
+		}
 
-		if (page_get_type(parent_page) == VM_FILE) continue;
+		short_of_frames = false;
+		lock_acquire (&src->lock);
+		hash_first (&i, &src->pages);
+		while (hash_next (&i)) {
+			struct page *parent_page = hash_entry (hash_cur (&i), struct page, elem_spt);
+
+			if (page_get_type(parent_page) == VM_FILE) continue;
+			if (spt_find_page (dst, parent_page->va) != NULL) continue;
+
+			if (parent_page->frame) {
+				/* Resident: the child gets a copy of its contents,
+				   so it needs no lazy loading of its own. */
+				if (copy_cnt == frame_cnt) {
+					short_of_frames = true;
+					break;
+				}
+				if (!vm_alloc_page_with_initializer (page_get_type(parent_page),
+							parent_page->va, parent_page->writable, NULL, NULL)) {
+					success = false;
+					break;
+				}
+				memcpy (frames[copy_cnt]->kva, parent_page->frame->kva, PGSIZE);
+				copies[copy_cnt++] = spt_find_page (dst, parent_page->va);
+				continue;
+			}
 
-		if ((parent_aux = parent_page->uninit.aux) != NULL) {
+			if ((parent_aux = parent_page->uninit.aux) != NULL) {
 
-			child_aux = (struct args_lazy *) malloc (sizeof (struct args_lazy));
-			if (child_aux == NULL) goto err;
+				child_aux = kmem_cache_alloc (args_lazy_cache);
+				if (child_aux == NULL) {
+					success = false;
+					break;
+				}
 
-			child_aux->file = parent_aux->file;
-			child_aux->ofs  = parent_aux->ofs;
-			child_aux->page_read_bytes = parent_aux->page_read_bytes;
-			child_aux->page_zero_bytes = parent_aux->page_zero_bytes;
-		} else {
-			child_aux = NULL;
+				child_aux->file = parent_aux->file;
+				child_aux->ofs  = parent_aux->ofs;
+				child_aux->page_read_bytes = parent_aux->page_read_bytes;
+				child_aux->page_zero_bytes = parent_aux->page_zero_bytes;
+			} else {
+				child_aux = NULL;
+			}
+
+			if (!vm_alloc_page_with_initializer (page_get_type(parent_page), parent_page->va, parent_page->writable, parent_page->uninit.init, (void *)child_aux)) {
+				kmem_cache_free (args_lazy_cache, child_aux);
+				success = false;
+				break;
+			}
 		}
-		 
-		if (!vm_alloc_page_with_initializer (page_get_type(parent_page), parent_page->va, parent_page->writable, parent_page->uninit.init, (void *)child_aux))
-			goto err;
+		lock_release (&src->lock);
+	} while (success && short_of_frames);
+
+	/* Map the copies in.  Reserved frames left over stay in the
+	   frame table with no page, where eviction takes them first. */
+	lock_acquire (&ft.lock);
+	for (j = 0; j < copy_cnt; j++)
+		if (success && !claim_with_frame (copies[j], frames[j]))
+			success = false;
+	lock_release (&ft.lock);
+
+	free (frames);
+	free (copies);
+	return success;
+}
 
-		if (parent_page->frame) {
-			if(!vm_do_claim_page(spt_find_page(dst, parent_page->va))) goto err;
-			memcpy(spt_find_page(dst, parent_page->va)->frame->kva, parent_page->frame->kva, PGSIZE);
-		}
-    }
-	return true;
+/* Returns the number of pages in SPT, other than file-backed
+   ones, that have a frame. */
+static size_t
+count_resident (struct supplemental_page_table *spt) {
+	struct hash_iterator i;
+	size_t cnt = 0;
 
-err:
-	return false;
+	lock_acquire (&spt->lock);
+	hash_first (&i, &spt->pages);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, elem_spt);
+
+		if (page_get_type (page) != VM_FILE && page->frame != NULL)
+			cnt++;
+	}
+	lock_release (&spt->lock);
+	return cnt;
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -429,7 +541,7 @@ page_less (const struct hash_elem *a_,
 
 bool frame_table_init(void) {
 
-	lock_init(&ft.lock);
+	lock_init_named(&ft.lock, "frame table");
 
 	return hash_init(&ft.frames, frame_hash, frame_less, NULL);
 }